@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+//A sprite in a texture atlas packed by pack-atlas (see pack_atlas.cpp), in atlas pixels (y down):
+// frame 0 is the width x height rectangle at (x, y), and the rest of the frames follow it
+// left to right, top to bottom, 'columns' frames per row.
+struct AtlasSprite {
+	uint32_t x, y;
+	uint32_t width, height;
+	uint32_t frames;
+	uint32_t columns;
+
+	//upper-left corner of frame 'f':
+	constexpr uint32_t frame_x(uint32_t f) const { return x + (f % columns) * width; }
+	constexpr uint32_t frame_y(uint32_t f) const { return y + (f / columns) * height; }
+};
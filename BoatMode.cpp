@@ -2,43 +2,62 @@
 
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
+#include "quad_indices.hpp"
 #include "data_path.hpp"
 
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
 
 #include <random>
-#include <sstream>
-#include <iomanip>
-
-BoatMode::BoatMode()
-	: boat(glm::vec2(0.5f * RIVER_WIDTH - 12.0f, START_Y), glm::vec2(20.0f, 34.0f), glm::vec2(24.0f, 36.0f), glm::vec2(0.0f, 0.0f), 0.0f),
+#include <algorithm>
+#include <cstddef>
+#include <cassert>
+#include <stdexcept>
+#include <cstring>
+
+BoatMode::BoatMode(uint32_t seed)
+	: sim(seed),
+	  prev_boat_position(sim.boat.position),
+	  prev_boat_rotation(sim.boat.rotation),
+	  prev_camera(sim.camera),
 	  music(data_path("music.wav"))
 	{
 
-	srand((int) time(NULL));
-
-	generateRiver(RIVERBANK_BUFFER_LENGTH);
+	recording.seed = seed;
+	recording.tick_rate = uint32_t(1.0f / Mode::Tick + 0.5f);
 
 	Sound::loop(music, 0.0f, 1.0f);
 
 	//----- allocate OpenGL resources -----
-	{ //vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
+	//(sprite_buffer allocates its store when constructed)
+
+	//sprites are rebuilt every frame into the same storage, so reserve enough up front that drawing doesn't allocate:
+	sprites.reserve(SPRITES_RESERVED);
+	sorted_sprites.reserve(SPRITES_RESERVED);
+	render_queue.reserve(RENDER_COMMANDS_RESERVED);
+	render_queue_scratch.reserve(RENDER_COMMANDS_RESERVED);
+	for (auto &mesh : text_meshes) {
+		mesh.sprites.reserve(TextMesh::MaxLength);
+	}
 
-		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+	{ //riverbank buffer (filled in by syncRiverbankMesh()):
+		glGenBuffers(1, &riverbank_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, riverbank_buffer);
+		glBufferData(GL_ARRAY_BUFFER, RIVERBANK_QUADS * 4 * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GL_ERRORS();
 	}
 
 	{ //vertex array mapping buffer for color_texture_program:
-		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the name of an unused vertex array object:
-		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
+		//ask OpenGL to fill riverbank_buffer_for_color_texture_program with the name of an unused vertex array object:
+		glGenVertexArrays(1, &riverbank_buffer_for_color_texture_program);
 
-		//set vertex_buffer_for_color_texture_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_texture_program);
+		//set riverbank_buffer_for_color_texture_program as the current vertex array object:
+		glBindVertexArray(riverbank_buffer_for_color_texture_program);
 
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+		//set riverbank_buffer as the source of glVertexAttribPointer() commands:
+		glBindBuffer(GL_ARRAY_BUFFER, riverbank_buffer);
 
 		//set up the vertex array object to describe arrays of BoatMode::Vertex:
 		glVertexAttribPointer(
@@ -72,15 +91,47 @@ BoatMode::BoatMode()
 		);
 		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
 
-		//done referring to vertex_buffer, so unbind it:
+		//done referring to riverbank_buffer, so unbind it:
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+		//quads' triangles come from the shared index buffer (this binding is part of the vertex array object):
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer());
+
 		//done setting up vertex array object, so unbind it:
 		glBindVertexArray(0);
 
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
 
+	{ //obstacle buffer (filled in by syncObstacleSprites(); starts out all zero-area sprites):
+		std::vector< uint8_t > zeros(OBSTACLE_SPRITES * sizeof(Sprite), 0);
+		glGenBuffers(1, &obstacle_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, obstacle_buffer);
+		glBufferData(GL_ARRAY_BUFFER, zeros.size(), zeros.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GL_ERRORS();
+	}
+
+	{ //vertex array mapping sprite_buffer (or obstacle_buffer) for sprite_program:
+		glGenVertexArrays(1, &sprite_buffer_for_sprite_program);
+		glBindVertexArray(sprite_buffer_for_sprite_program);
+
+		//every attribute is per-instance (the attribute pointers themselves are set in drawSprites(), since
+		// each frame's sprites start at a different place in sprite_buffer):
+		for (GLuint attribute : { sprite_program.Position_vec2, sprite_program.Size_vec2, sprite_program.TexRect_vec4, sprite_program.Color_vec4, sprite_program.Rotation_vec2, sprite_program.Cycle_vec4, sprite_program.Frames_vec4 }) {
+			glEnableVertexAttribArray(attribute);
+			glVertexAttribDivisor(attribute, 1);
+		}
+
+		//each instance is drawn as one quad:
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer());
+
+		glBindVertexArray(0);
+
+		GL_ERRORS();
+	}
+
 	{ //solid white texture:
 		//ask OpenGL to fill white_tex with the name of an unused texture object:
 		glGenTextures(1, &white_tex);
@@ -109,39 +160,150 @@ BoatMode::BoatMode()
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
 
-	{ //load tileset texture:
+	{ //load tileset texture (one palette index per texel) and its palette:
 		std::vector< glm::u8vec4 > data;
 		glm::uvec2 size(0, 0);
-		load_png(data_path("boat.png"), &size, &data, UpperLeftOrigin);
-		tileset_size = size;
-		tileset_tiles = glm::vec2(tileset_size.x / tilesize.x, tileset_size.y / tilesize.y);
+		load_png(data_path("boat-atlas-index.png"), &size, &data, UpperLeftOrigin);
+		if (size != glm::uvec2(boat_atlas::Width, boat_atlas::Height)) {
+			throw std::runtime_error("boat-atlas-index.png doesn't match boat_atlas.hpp; re-run pack-atlas.");
+		}
+
+		//(the png has the index in every color channel; only one byte per texel is kept)
+		std::vector< uint8_t > indices(data.size());
+		for (size_t i = 0; i < data.size(); ++i) {
+			if (data[i].r >= boat_atlas::PaletteSize) {
+				throw std::runtime_error("boat-atlas-index.png has indices past the end of the palette; re-run pack-atlas.");
+			}
+			indices[i] = data[i].r;
+		}
 
 		glGenTextures(1, &tileset_tex);
 
 		glBindTexture(GL_TEXTURE_2D, tileset_tex);
 
+		//(rows of single bytes aren't 4-byte aligned)
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size.x, size.y, 0, GL_RED, GL_UNSIGNED_BYTE, indices.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		//(indices can't be blended, so this must stay GL_NEAREST)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		load_png(data_path("boat-atlas-palette.png"), &size, &data, UpperLeftOrigin);
+		if (size != glm::uvec2(boat_atlas::PaletteSize, 1)) {
+			throw std::runtime_error("boat-atlas-palette.png doesn't match boat_atlas.hpp; re-run pack-atlas.");
+		}
+
+		glGenTextures(1, &palette_tex);
+
+		glBindTexture(GL_TEXTURE_2D, palette_tex);
+
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
 
+		//(read with texelFetch, but a texture without mipmaps must not use a mipmapping filter to be complete)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 		glBindTexture(GL_TEXTURE_2D, 0);
 
+		//color_texture_program only ever draws the tileset here:
+		glUseProgram(color_texture_program.program);
+		glUniform1i(color_texture_program.INDEXED_bool, GL_TRUE);
+		glUseProgram(0);
+
 		GL_ERRORS();
 	}
+
+	{ //riverbank edge texture (filled in by syncRiverbankEdges()):
+		glGenTextures(1, &riverbank_edges_tex);
+
+		glBindTexture(GL_TEXTURE_2D, riverbank_edges_tex);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, BoatSim::RIVERBANK_ROWS, 1, 0, GL_RG, GL_FLOAT, nullptr);
+
+		//(read with texelFetch, but a texture without mipmaps must not use a mipmapping filter to be complete)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenVertexArrays(1, &empty_vertex_array);
+
+		GL_ERRORS();
+	}
+
+	{ //scene framebuffer (the game is drawn at its own resolution, then scaled up to the window by draw()):
+		glGenTextures(1, &scene_tex);
+
+		glBindTexture(GL_TEXTURE_2D, scene_tex);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, RIVER_WIDTH, RIVER_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &scene_framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, scene_framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scene_tex, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("Scene framebuffer is incomplete.");
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		GL_ERRORS();
+	}
+
+	//(needs the tileset, sprite_buffer_for_sprite_program, and the reserved sprites)
+	bakeBoatStacks();
+
+	syncRiverbankMesh();
+	syncRiverbankEdges();
+	syncObstacleSprites();
 }
 
 BoatMode::~BoatMode() {
 
 	//----- free OpenGL resources -----
-	glDeleteBuffers(1, &vertex_buffer);
-	vertex_buffer = 0;
+	//(sprite_buffer frees its own)
 
-	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
-	vertex_buffer_for_color_texture_program = 0;
+	glDeleteBuffers(1, &riverbank_buffer);
+	riverbank_buffer = 0;
+
+	glDeleteVertexArrays(1, &riverbank_buffer_for_color_texture_program);
+	riverbank_buffer_for_color_texture_program = 0;
+
+	glDeleteBuffers(1, &obstacle_buffer);
+	obstacle_buffer = 0;
+
+	glDeleteVertexArrays(1, &sprite_buffer_for_sprite_program);
+	sprite_buffer_for_sprite_program = 0;
 
 	glDeleteTextures(1, &white_tex);
 	white_tex = 0;
+
+	glDeleteTextures(1, &tileset_tex);
+	tileset_tex = 0;
+
+	glDeleteTextures(1, &palette_tex);
+	palette_tex = 0;
+
+	glDeleteTextures(1, &riverbank_edges_tex);
+	riverbank_edges_tex = 0;
+
+	glDeleteTextures(1, &boat_stack_tex);
+	boat_stack_tex = 0;
+
+	glDeleteVertexArrays(1, &empty_vertex_array);
+	empty_vertex_array = 0;
+
+	glDeleteFramebuffers(1, &scene_framebuffer);
+	scene_framebuffer = 0;
+
+	glDeleteTextures(1, &scene_tex);
+	scene_tex = 0;
 }
 
 bool BoatMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
@@ -149,461 +311,572 @@ bool BoatMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size)
 }
 
 void BoatMode::update(float elapsed) {
-	camera_speed = CAMERA_START_SPEED + 0.4f * (0.4f * score);
-	if (camera_speed > MAX_CAMERA_SPEED) camera_speed = MAX_CAMERA_SPEED;
-	if (!game_over && camera_started) {
-		if (boat.position.y - camera.y <= CAMERA_ACCEL_ZONE) camera.y += -camera_speed * elapsed + 50.0f * (boat.position.y - camera.y - CAMERA_ACCEL_ZONE) * elapsed * elapsed;
-		else camera.y -= camera_speed * elapsed;
-	}
-
-	boxes.remove_if([this](const Box &box) -> bool { return box.position.y - camera.y > RIVER_HEIGHT; });
-
-	if (riverbank[riverbank_last].position_left.y - camera.y >= 0) {
-		generateRiver(RIVERBANK_GENERATE);
-	}
-
 	elapsed_time += elapsed;
+	while (elapsed_time >= ANIMATION_PERIOD) elapsed_time -= ANIMATION_PERIOD;
 	ripple_frame += ripple_frames * elapsed / BOB_TIME;
 	while (ripple_frame >= ripple_frames) ripple_frame -= ripple_frames;
 
-	glm::vec2 acceleration(0.0f, 0.0f);
+	BoatSim::Input input;
+	if (playing_back) {
+		if (playback_tick >= playback.inputs.size()) {
+			Mode::set_current(nullptr);
+			return;
+		}
+		input = playback.input(playback_tick++);
+	} else {
+		const Uint8 *state = SDL_GetKeyboardState(NULL);
+		input.left = state[SDL_SCANCODE_LEFT];
+		input.right = state[SDL_SCANCODE_RIGHT];
+		input.up = state[SDL_SCANCODE_UP];
+		input.down = state[SDL_SCANCODE_DOWN];
+		input.space = state[SDL_SCANCODE_SPACE];
+	}
+	recording.record(input);
+
+	prev_boat_position = sim.boat.position;
+	prev_boat_rotation = sim.boat.rotation;
+	prev_camera = sim.camera;
+
+	bool was_game_over = sim.game_over;
+	sim.update(elapsed, input);
+	syncRiverbankMesh();
+	syncRiverbankEdges();
+	syncObstacleSprites();
+
+	//don't blend across a restart:
+	if (was_game_over && !sim.game_over) {
+		prev_boat_position = sim.boat.position;
+		prev_boat_rotation = sim.boat.rotation;
+		prev_camera = sim.camera;
+	}
+}
 
-	const Uint8 *state = SDL_GetKeyboardState(NULL);
+void BoatMode::interpolate(float alpha) {
+	tick_alpha = alpha;
+}
 
-	if (!game_over) {
-		if (state[SDL_SCANCODE_LEFT]) {
-			boat.rotation += ROTATION_SPEED * elapsed;
-		} if (state[SDL_SCANCODE_RIGHT]) {
-			boat.rotation -= ROTATION_SPEED * elapsed;
-		}
-	
-		if (state[SDL_SCANCODE_UP]) {
-			acceleration = glm::vec2(-glm::sin(boat.rotation) * ACCEL_SPEED, -glm::cos(boat.rotation) * ACCEL_SPEED);
-		} else if (state[SDL_SCANCODE_DOWN]) {
-			acceleration = glm::vec2(glm::sin(boat.rotation) * ACCEL_SPEED, glm::cos(boat.rotation) * ACCEL_SPEED);
-		}
-		else acceleration += -boat.velocity * 100.0f * elapsed;
+void BoatMode::drawTrapezoid(std::vector< Vertex > &vertices, float top, glm::vec2 top_x, float bottom, glm::vec2 bottom_x, glm::vec2 texcoord, glm::u8vec4 color) {
+	//draw as a CCW-oriented quad (same winding as drawTexture):
+	vertices.emplace_back(glm::vec3(top_x.x, top, 0.0f), color, texcoord);
+	vertices.emplace_back(glm::vec3(top_x.y, top, 0.0f), color, texcoord);
+	vertices.emplace_back(glm::vec3(bottom_x.y, bottom, 0.0f), color, texcoord);
+	vertices.emplace_back(glm::vec3(bottom_x.x, bottom, 0.0f), color, texcoord);
+}
 
-		boat.velocity += acceleration * elapsed;
-		if (glm::length(boat.velocity) > MOVE_SPEED) {
-			boat.velocity = MOVE_SPEED * (boat.velocity / glm::length(boat.velocity));
-		}
+void BoatMode::drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color) {
+	//corners are worked out by sprite_program's vertex shader:
+	sprites.emplace_back(pos, size, glm::vec4(tilepos, tilesize), color, glm::vec2(1.0f, 0.0f));
+}
 
-		auto collision = [](Box b1, Boat b2) -> bool {
-			if (b1.position.x >= b2.position.x + b2.size.x ||
-				b1.position.x <= b2.position.x - b1.size.x ||
-				b1.position.y >= b2.position.y + b2.size.y ||
-				b1.position.y <= b2.position.y - b1.size.y) return false;
-			return true;
-		};
-		auto collision_bomb = [](Bomb b1, Boat b2) -> bool {
-			if (b1.position.x >= b2.position.x + b2.size.x ||
-				b1.position.x <= b2.position.x - b1.size.x ||
-				b1.position.y >= b2.position.y + b2.size.y ||
-				b1.position.y <= b2.position.y - b1.size.y) return false;
-			return true;
-		};
-		auto collision_bank = [](RiverbankPoint b1, Boat b2) -> bool {
-			if (b1.position_left.y >= b2.position.y && b1.position_left.y < b2.position.y + b2.size.y) {
-				if (b2.position.x >= b1.position_left.x && b2.position.x + b2.size.x <= b1.position_right.x) return false;
-				else return true;
-			}
-			return false;
-		};
+void BoatMode::drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, glm::vec2 rotation) {
+	sprites.emplace_back(pos, size, glm::vec4(tilepos, tilesize), color, rotation);
+}
 
-		boat.position.x += boat.velocity.x * elapsed + acceleration.x * elapsed * elapsed * 0.5f;
-		for (Box box: boxes) {
-			if (collision(box, boat)) {
-				if (boat.velocity.x > 0) {
-					boat.position.x = box.position.x - boat.size.x;
-				}
-				else {
-					boat.position.x = box.position.x + box.size.x;
-				}
-				boat.velocity.x = 0;
-			}
-		}
-		for (Bomb bomb: bombs) {
-			if (collision_bomb(bomb, boat)) {
-				game_over = true;
-			}
-		}
-		if (boat.position.x + boat.size.x >= RIVER_WIDTH) boat.position.x = RIVER_WIDTH - boat.size.x;
-		if (boat.position.x <= 0) boat.position.x = 0;
-
-		boat.position.y += boat.velocity.y * elapsed + acceleration.y * elapsed * elapsed * 0.5f;
-		for (Box box: boxes) {
-			if (collision(box, boat)) {
-				if (boat.velocity.y > 0) {
-					boat.position.y = box.position.y - boat.size.y;
-				}
-				else {
-					boat.position.y = box.position.y + box.size.y;
-				}
-				boat.velocity.y = 0;
-			}
-		}
-		for (Bomb bomb: bombs) {
-			if (collision_bomb(bomb, boat)) {
-				game_over = true;
-			}
-		}
-		if (!camera_started && boat.position.y <= RIVER_HEIGHT * 0.5f) camera_started = true;
-		if (boat.position.y - camera.y >= RIVER_HEIGHT + 96.0f) {
-			game_over = true;
-		}
-		if (boat.position.y - camera.y <= 0) boat.position.y = camera.y;
+void BoatMode::drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, float rotation) {
+	drawTexture(sprites, pos, size, tilepos, tilesize, color, glm::vec2(glm::cos(rotation), glm::sin(rotation)));
+}
+
+glm::vec4 BoatMode::atlasRect(AtlasSprite const &sprite, uint32_t frame) {
+	const glm::vec2 atlas_size = glm::vec2(boat_atlas::Width, boat_atlas::Height);
+	return glm::vec4(
+		glm::vec2(sprite.frame_x(frame), sprite.frame_y(frame)) / atlas_size,
+		glm::vec2(sprite.width, sprite.height) / atlas_size
+	);
+}
 
-		score = glm::max(score, (START_Y - boat.position.y) / 24.0f);
+glm::vec4 BoatMode::atlasFrames(AtlasSprite const &sprite) {
+	const glm::vec2 atlas_size = glm::vec2(boat_atlas::Width, boat_atlas::Height);
+	return glm::vec4(
+		glm::vec2(sprite.frames, sprite.columns),
+		glm::vec2(sprite.width, sprite.height) / atlas_size
+	);
+}
 
-		if (normal_river_width > MIN_NORMAL_RIVER_WIDTH) normal_river_width = START_NORMAL_RIVER_WIDTH - 1.5f * (0.4f * score);
-		else normal_river_width = MIN_NORMAL_RIVER_WIDTH;
+glm::vec2 BoatMode::atlasTexel(AtlasSprite const &sprite) {
+	return (glm::vec2(sprite.x, sprite.y) + 0.5f) / glm::vec2(boat_atlas::Width, boat_atlas::Height);
+}
 
-		for (int i = 0; i < RIVERBANK_BUFFER_LENGTH; i++) {
-			if (collision_bank(riverbank[i], boat)) {
-				game_over = true;
-				break;
-			}
-		}
+//font glyph (frame of boat_atlas::font) for each character, or -1 for characters the font doesn't have:
+struct GlyphTable {
+	int8_t glyph[128];
+};
+static constexpr GlyphTable make_glyph_table() {
+	//(same order as the glyphs in boat-atlas.txt)
+	char const *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789. ";
+	GlyphTable table = {};
+	for (uint32_t c = 0; c < 128; ++c) {
+		table.glyph[c] = -1;
 	}
-	else {
-		if (state[SDL_SCANCODE_SPACE]) {
-			reset_level();
-		}
+	for (uint32_t i = 0; alphabet[i] != '\0'; ++i) {
+		table.glyph[uint8_t(alphabet[i])] = int8_t(i);
+	}
+	return table;
+}
+static constexpr GlyphTable glyph_table = make_glyph_table();
+static_assert(glyph_table.glyph['A'] == 0 && glyph_table.glyph['0'] == 26 && glyph_table.glyph[' '] == 37, "glyph table out of order");
+
+//writes the decimal digits of 'value' to 'out' (which needs room for 10), returning how many were written:
+static size_t format_uint(uint32_t value, char *out) {
+	char digits[10];
+	size_t count = 0;
+	do {
+		digits[count++] = char('0' + value % 10);
+		value /= 10;
+	} while (value != 0);
+	for (size_t i = 0; i < count; ++i) {
+		out[i] = digits[count - 1 - i];
 	}
+	return count;
 }
 
-void BoatMode::reset_level() {
-	score = 0.0f;
+void BoatMode::drawText(std::vector< Sprite > &sprites, Text which, char const *text, size_t length, glm::vec2 pos, float scale, glm::u8vec4 color) {
+	assert(length <= TextMesh::MaxLength);
+	TextMesh &mesh = text_meshes[which];
+
+	if (mesh.length != length || !std::equal(text, text + length, mesh.text) || mesh.pos != pos || mesh.scale != scale || mesh.color != color) {
+		const glm::vec2 CHAR_SIZE(boat_atlas::font.width, boat_atlas::font.height);
+		const glm::vec2 CHAR_OFFSET(12.0f, 0.0f);
+
+		std::copy(text, text + length, mesh.text);
+		mesh.length = length;
+		mesh.pos = pos;
+		mesh.scale = scale;
+		mesh.color = color;
+
+		mesh.sprites.clear();
+		glm::vec2 next_char_pos = pos;
+		for (size_t i = 0; i < length; ++i) {
+			uint8_t c = uint8_t(text[i]);
+			int32_t glyph = (c < 128 ? glyph_table.glyph[c] : -1);
+			if (glyph < 0) continue; //(characters without glyphs take up no space)
+			glm::vec4 rect = atlasRect(boat_atlas::font, uint32_t(glyph));
+			drawTexture(mesh.sprites, next_char_pos, CHAR_SIZE * scale, glm::vec2(rect.x, rect.y), glm::vec2(rect.z, rect.w), color);
+			next_char_pos += CHAR_OFFSET * scale;
+		}
+	}
 
-	boat.rotation = 0.0f;
-	boat.position = glm::vec2(0.5f * RIVER_WIDTH - 12.0f, START_Y);
-	boat.velocity = glm::vec2(0.0f, 0.0f);
+	sprites.insert(sprites.end(), mesh.sprites.begin(), mesh.sprites.end());
+}
 
-	camera = glm::vec2(0.0f, 0.0f);
-	camera_started = false;
-	camera_speed = CAMERA_START_SPEED;
+void BoatMode::drawBoatRipples(std::vector< Sprite > &sprites) {
+	glm::vec2 bob = glm::vec2(0.0f, 1.0f * glm::sin(5.0f + draw_time * 2.0f * glm::pi<float>() / BOB_TIME));
+	glm::vec2 layer_offset = glm::vec2(0.0f, BOAT_UNDERWATER_LAYER * -1.0f);
+
+	//layers up to the ripple, pre-drawn by bakeBoatStacks() around the center of layer 0:
+	// (drawn from boat_stack_tex, on its own layer, so draw() expects this to be the first sprite)
+	glm::vec4 stack = boatStackRect(draw_boat_rotation, false);
+	drawTexture(
+		sprites,
+		draw_boat_position + 0.5f * sim.boat.size + bob - boat_stack_anchor,
+		boat_stack_cell,
+		glm::vec2(stack.x, stack.y),
+		glm::vec2(stack.z, stack.w),
+		glm::u8vec4(255, 255, 255, 255)
+	);
 
-	boxes.clear();
-	bombs.clear();
+	glm::vec4 ripple = atlasRect(boat_atlas::boat_ripple, uint32_t(draw_ripple_frame) % boat_atlas::boat_ripple.frames);
+	drawTexture(
+		sprites,
+		draw_boat_position + layer_offset + glm::vec2(-12.0f, -18.0f) + 0.5f * (sim.boat.size - sim.boat.drawsize),
+		glm::vec2(48.0f, 72.0f),
+		glm::vec2(ripple.x, ripple.y),
+		glm::vec2(ripple.z, ripple.w),
+		glm::u8vec4(255, 255, 255, 255),
+		draw_boat_rotation
+	);
+}
 
-	normal_river_width = RIVER_WIDTH;
-	riverbank_empty = true;
-	generateRiver(RIVERBANK_BUFFER_LENGTH);
+void BoatMode::drawBoat(std::vector< Sprite > &sprites) {
+	glm::vec2 bob = glm::vec2(0.0f, 1.0f * glm::sin(5.0f + draw_time * 2.0f * glm::pi<float>() / BOB_TIME));
+
+	//layers above the ripple, pre-drawn by bakeBoatStacks() around the center of layer 0:
+	// (drawn from boat_stack_tex, on its own layer)
+	glm::vec4 stack = boatStackRect(draw_boat_rotation, true);
+	drawTexture(
+		sprites,
+		draw_boat_position + 0.5f * sim.boat.size + bob - boat_stack_anchor,
+		boat_stack_cell,
+		glm::vec2(stack.x, stack.y),
+		glm::vec2(stack.z, stack.w),
+		glm::u8vec4(255, 255, 255, 255)
+	);
+}
 
-	game_over = false;
+glm::vec4 BoatMode::boatStackRect(float rotation, bool upper) const {
+	int32_t step = int32_t(std::floor(rotation * (BOAT_STACK_ROTATIONS / (2.0f * glm::pi<float>())) + 0.5f));
+	step = ((step % BOAT_STACK_ROTATIONS) + BOAT_STACK_ROTATIONS) % BOAT_STACK_ROTATIONS;
+	glm::vec2 cell = glm::vec2(step % BOAT_STACK_COLUMNS, (step / BOAT_STACK_COLUMNS) * 2 + (upper ? 1 : 0));
+	return glm::vec4(cell * boat_stack_cell / boat_stack_tex_size, boat_stack_cell / boat_stack_tex_size);
 }
 
-void BoatMode::generateRiver(int num_samples) {
-	int pixels_since_obj = 1000;
-	int min_pixels_since_obj = 144;
-	for (int i = 0; i <= num_samples; i++) {
-		pixels_since_obj++;
+void BoatMode::bakeBoatStacks() {
+	const int rows = (BOAT_STACK_ROTATIONS / BOAT_STACK_COLUMNS) * 2;
+	glm::uvec2 size = glm::uvec2(glm::vec2(BOAT_STACK_COLUMNS, rows) * boat_stack_cell);
+	boat_stack_tex_size = glm::vec2(size);
 
-		RiverbankPoint current;
-		if (riverbank_empty) {
-			current.position_left = glm::vec2(0, RIVER_HEIGHT);
-			current.momentum_left = 1;
-			current.position_right = glm::vec2(RIVER_WIDTH - 1, RIVER_HEIGHT);
-			current.momentum_right = -1;
-		}
-		else {
-			RiverbankPoint prev = riverbank[riverbank_last];
-			current = prev;
-			current.position_left.x += current.momentum_left;
-			current.position_left.y--;
-			current.position_right.x += current.momentum_right;
-			current.position_right.y--;
-
-			// mutate
-			//current.momentum_left += 0.005f * (0.01f * (rand() % 100) - 1.0f);
-			//current.momentum_right -= 0.005f * (0.01f * (rand() % 100) - 1.0f);
-
-			if (current.position_left.x < 0) {
-				current.position_left.x = 0;
-				current.momentum_left *= -1;
-			}
-			if (current.position_right.x >= RIVER_WIDTH) {
-				current.position_right.x = (float) RIVER_WIDTH - 1.0f;
-				current.momentum_right *= -1;
-			}
+	glGenTextures(1, &boat_stack_tex);
+	glBindTexture(GL_TEXTURE_2D, boat_stack_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
 
-			float gap = current.position_right.x - current.position_left.x;
-
-			if (gap <= MIN_RIVER_WIDTH) {
-				if (current.momentum_left > 0 && current.momentum_right < 0) {
-					if (glm::abs(current.momentum_left) > glm::abs(current.momentum_right)) current.momentum_left *= -1;
-					else current.momentum_right *= -1;
-				} else if (current.momentum_left > 0) current.momentum_left *= -1;
-				else if (current.momentum_right < 0) current.momentum_right *= 1;
-			} else if (gap <= normal_river_width) {
-				if (rand() % 100 >= 95) {
-					if (current.momentum_left > 0 && current.momentum_right < 0) {
-						if (rand() % 2 == 0) current.momentum_left *= -1;
-						else current.momentum_right *= -1;
-					} else if (current.momentum_left > 0) current.momentum_left *= -1;
-					else if (current.momentum_right < 0) current.momentum_right *= -1;
-				}
-
-				if (rand() % 10 >= 2 && pixels_since_obj > min_pixels_since_obj && current.position_left.y - camera.y + 48.0f < 0.0f) {
-					if (score >= 150.0f && rand() % 5 == 1) {
-						int minx = (int) current.position_left.x + 12;
-						int maxx = (int) current.position_right.x - 24 - 12;
-						int x = (rand() % (maxx - minx)) + minx;
-						bombs.push_back(Bomb(glm::vec2(x, current.position_left.y), glm::vec2(12.0f, 1.0f), 0.1f * (rand() % 10)));
-						pixels_since_obj = 0;
-					} else {
-						int minx = (int) current.position_left.x + 12;
-						int maxx = (int) current.position_right.x - 24 - 12;
-						int x = (rand() % (maxx - minx)) + minx;
-						boxes.push_back(Box(glm::vec2(x, current.position_left.y), glm::vec2(24.0f, 24.0f), 0.1f * (rand() % 10)));
-						pixels_since_obj = 0;
-					}
-				}
-			}
-		}
+	GLuint framebuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, boat_stack_tex, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Boat stack framebuffer is incomplete.");
+	}
 
-		riverbank_last = (riverbank_last + 1) % RIVERBANK_BUFFER_LENGTH;
-		riverbank[riverbank_last] = current; // add to the front of the ring buffer
+	GLint old_viewport[4];
+	glGetIntegerv(GL_VIEWPORT, old_viewport);
+	glViewport(0, 0, size.x, size.y);
 
-		riverbank_empty = false;
-	}
-}
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
 
-void BoatMode::drawTexture(std::vector< Vertex > &vertices, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, float rotation) {
+	//layers are composited over each other, keeping the stack's coverage in alpha
+	// (the tileset's alpha is all 0 or 255, so this matches drawing the layers straight to the screen):
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
 
-	glm::mat4 rotate_around_origin_mat = glm::mat4(
-		glm::vec4(glm::cos(rotation), -glm::sin(rotation), 0.0f, 0.0f),
-		glm::vec4(glm::sin(rotation), glm::cos(rotation), 0.0f, 0.0f),
+	//cell pixels map straight to texels (y not flipped, so cells are upright when sampled like the tileset):
+	glm::mat4 pixels_to_clip = glm::mat4(
+		glm::vec4(2.0f / size.x, 0.0f, 0.0f, 0.0f),
+		glm::vec4(0.0f, 2.0f / size.y, 0.0f, 0.0f),
 		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
 		glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)
 	);
+	glm::vec4 pixels_clip_offset = glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
 
-	glm::vec2 rotation_center_2d = pos + 0.5f * size;
+	glUseProgram(sprite_program.program);
+	glUniformMatrix4fv(sprite_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(pixels_to_clip));
+	glUniform4fv(sprite_program.CLIP_OFFSET_vec4, 1, glm::value_ptr(pixels_clip_offset));
+	glUniform1i(sprite_program.INDEXED_bool, GL_TRUE);
 
-	glm::mat4 translate_to_origin_mat = glm::mat4(
-		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(-rotation_center_2d.x, -rotation_center_2d.y, 0.0f, 1.0f)
-	);
+	//(the stacks themselves are baked as colors, not palette indices)
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, palette_tex);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tileset_tex);
 
-	glm::mat4 translate_to_center_mat = glm::mat4(
-		glm::vec4(1.0f, 0.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 1.0f, 0.0f, 0.0f),
-		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
-		glm::vec4(rotation_center_2d.x, rotation_center_2d.y, 0.0f, 1.0f)
-	);
+	//layers are drawn a few rotations at a time, so each batch fits in sprite_buffer's regions:
+	auto flush = [&]() {
+		drawSprites(sprite_buffer.buffer, sprite_buffer.upload(sprites.data(), sprites.size()), sprites.size());
+		sprite_buffer.fence();
+		sprites.clear();
+	};
 
-	glm::mat4 rotate_around_center_mat = translate_to_center_mat * rotate_around_origin_mat * translate_to_origin_mat;
+	sprites.clear();
+	for (int32_t step = 0; step < BOAT_STACK_ROTATIONS; ++step) {
+		if (sprites.size() + BOAT_LAYERS > SPRITES_RESERVED) flush();
+		float rotation = step * (2.0f * glm::pi<float>() / BOAT_STACK_ROTATIONS);
+		glm::vec2 boat_rotation = glm::vec2(glm::cos(rotation), glm::sin(rotation));
+		for (int i = 0; i < BOAT_LAYERS; i++) {
+			glm::vec4 cell = boatStackRect(rotation, i > BOAT_UNDERWATER_LAYER);
+			glm::vec2 layer_offset = glm::vec2(0.0f, i * -1.0f);
+			glm::vec4 layer = atlasRect(boat_atlas::boat_layers, i);
+			drawTexture(
+				sprites,
+				glm::vec2(cell.x, cell.y) * boat_stack_tex_size + boat_stack_anchor + layer_offset - 0.5f * sim.boat.drawsize,
+				sim.boat.drawsize,
+				glm::vec2(layer.x, layer.y),
+				glm::vec2(layer.z, layer.w),
+				glm::u8vec4(255, 255, 255, 255),
+				boat_rotation
+			);
+		}
+	}
+	flush();
 
-	//inline helper function for textured rectangle drawing:
-	auto draw_tex_rectangle = [&vertices, &rotate_around_center_mat](glm::vec2 const &pos, glm::vec2 const &size, glm::vec2 const &tilepos, glm::vec2 const &tilesize, glm::u8vec4 const &color) {
-		// bot_left will be top left on screen after clip transformation
-		glm::vec4 bot_left = rotate_around_center_mat * glm::vec4(pos.x, pos.y, 0.0f, 1.0f);
-		glm::vec4 bot_right = rotate_around_center_mat * glm::vec4(pos.x+size.x, pos.y, 0.0f, 1.0f);
-		glm::vec4 top_right = rotate_around_center_mat * glm::vec4(pos.x+size.x, pos.y+size.y, 0.0f, 1.0f);
-		glm::vec4 top_left = rotate_around_center_mat * glm::vec4(pos.x, pos.y+size.y, 0.0f, 1.0f);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	glViewport(old_viewport[0], old_viewport[1], old_viewport[2], old_viewport[3]);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &framebuffer);
+
+	GL_ERRORS();
+}
 
-		//draw rectangle as two CCW-oriented triangles:
-		vertices.emplace_back(glm::vec3(bot_left), color, glm::vec2(tilepos.x, tilepos.y));
-		vertices.emplace_back(glm::vec3(bot_right), color, glm::vec2(tilepos.x+tilesize.x, tilepos.y));
-		vertices.emplace_back(glm::vec3(top_right), color, glm::vec2(tilepos.x+tilesize.x, tilepos.y+tilesize.y));
+void BoatMode::drawSprites(GLuint buffer, size_t first, size_t count) {
+	if (count == 0) return;
+	glBindVertexArray(sprite_buffer_for_sprite_program);
+
+	//point the per-instance attributes at sprite 'first' of 'buffer':
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	GLbyte *base = (GLbyte *)0 + first * sizeof(Sprite);
+	glVertexAttribPointer(sprite_program.Position_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, Position));
+	glVertexAttribPointer(sprite_program.Size_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, Size));
+	glVertexAttribPointer(sprite_program.TexRect_vec4, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, TexRect));
+	glVertexAttribPointer(sprite_program.Color_vec4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Sprite), base + offsetof(Sprite, Color));
+	glVertexAttribPointer(sprite_program.Rotation_vec2, 2, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, Rotation));
+	glVertexAttribPointer(sprite_program.Cycle_vec4, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, Cycle));
+	glVertexAttribPointer(sprite_program.Frames_vec4, 4, GL_FLOAT, GL_FALSE, sizeof(Sprite), base + offsetof(Sprite, Frames));
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, (GLbyte *)0, GLsizei(count));
+}
 
-		vertices.emplace_back(glm::vec3(bot_left), color, glm::vec2(tilepos.x, tilepos.y));
-		vertices.emplace_back(glm::vec3(top_right), color, glm::vec2(tilepos.x+tilesize.x, tilepos.y+tilesize.y));
-		vertices.emplace_back(glm::vec3(top_left), color, glm::vec2(tilepos.x, tilepos.y+tilesize.y));
+void BoatMode::syncObstacleSprites() {
+	glBindBuffer(GL_ARRAY_BUFFER, obstacle_buffer);
+
+	//rewrite slots whose obstacle came or went:
+	// (slots are told apart by position and bob, since a retry respawns a new course into the same slots)
+	auto sync_pool = [](auto const &pool, ObstacleSlot *slots, auto const &write) {
+		for (size_t slot = 0; slot < pool.capacity(); ++slot) {
+			bool live = (slot + pool.capacity() - pool.head) % pool.capacity() < pool.size();
+			glm::vec2 position = glm::vec2(pool.x[slot], pool.y[slot]);
+			float bob_offset = pool.bob_offset[slot];
+			if (live == slots[slot].live && (!live || (position == slots[slot].position && bob_offset == slots[slot].bob_offset))) continue;
+			write(slot, live);
+			slots[slot].live = live;
+			slots[slot].position = position;
+			slots[slot].bob_offset = bob_offset;
+		}
 	};
+	sync_pool(sim.boxes, box_slots, [this](size_t slot, bool live) { writeBoxSprites(slot, live); });
+	sync_pool(sim.bombs, bomb_slots, [this](size_t slot, bool live) { writeBombSprites(slot, live); });
 
-	draw_tex_rectangle(pos, size, tilepos, tilesize, color);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	GL_ERRORS();
 }
 
-void BoatMode::drawText(std::vector< Vertex > &vertices, std::string text, glm::vec2 pos, float scale, glm::u8vec4 color) {
-	std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789. ";
-	const glm::vec2 CHAR_SIZE(11.0f, 14.0f);
-	const glm::vec2 CHAR_OFFSET(12.0f, 0.0f);
-	const glm::vec2 CHAR_TILESET_SIZE(11.0f / tileset_size.x, 14.0f / tileset_size.y);
-	const glm::vec2 CHAR_TILESET_OFFSET(11.0f / tileset_size.x, 0.0f);
-	const glm::vec2 CHAR_TILESET_ORIGIN(0.0f, 396.0f / tileset_size.y);
+void BoatMode::writeBoxSprites(size_t slot, bool live) {
+	const glm::u8vec4 white = glm::u8vec4(255, 255, 255, 255);
+	glm::vec2 position = glm::vec2(sim.boxes.x[slot], sim.boxes.y[slot]);
+	float phase = sim.boxes.bob_offset[slot] / (2.0f * glm::pi<float>());
+	//the box bobs; its ripple doesn't, but steps through its frames in time with the bob:
+	glm::vec4 bob_cycle = glm::vec4(phase, 1.0f / BOB_TIME, 0.0f, 1.0f);
+	glm::vec4 ripple_cycle = glm::vec4(phase, 0.0f, 1.0f / BOB_TIME, 0.0f);
+	glm::vec2 size = live ? glm::vec2(24.0f, 36.0f) : glm::vec2(0.0f); //(empty slots are zero-area)
+	glm::vec2 ripple_size = live ? glm::vec2(48.0f, 72.0f) : glm::vec2(0.0f);
+
+	Sprite under[2] = {
+		//underwater portion:
+		Sprite(position + glm::vec2(0.0f, 24.0f), size, atlasRect(boat_atlas::box_underwater), white, glm::vec2(1.0f, 0.0f), bob_cycle),
+		//ripples:
+		Sprite(position + glm::vec2(-12.0f, -30.0f), ripple_size, atlasRect(boat_atlas::box_ripple), white, glm::vec2(1.0f, 0.0f),
+			ripple_cycle, atlasFrames(boat_atlas::box_ripple)),
+	};
+	Sprite box = Sprite(position + glm::vec2(0.0f, -12.0f), size, atlasRect(boat_atlas::box), white, glm::vec2(1.0f, 0.0f), bob_cycle);
 
-	glm::vec2 next_char_pos = pos;
-	for (char const c: text) {
-		for (int i = 0; i < alphabet.size(); i++) {
-			if (alphabet[i] == c) {
-				drawTexture(vertices, next_char_pos, CHAR_SIZE * scale, CHAR_TILESET_ORIGIN + ((float) i) * CHAR_TILESET_OFFSET, CHAR_TILESET_SIZE, color, 0.0f);
-				next_char_pos += CHAR_OFFSET * scale;
-				break;
-			}
-		}
-	}
+	//(obstacle_buffer must be bound to GL_ARRAY_BUFFER)
+	glBufferSubData(GL_ARRAY_BUFFER, (BOX_RIPPLE_SPRITES + 2 * slot) * sizeof(Sprite), sizeof(under), under);
+	glBufferSubData(GL_ARRAY_BUFFER, (BOX_SPRITES + slot) * sizeof(Sprite), sizeof(box), &box);
 }
 
-void BoatMode::drawBoatRipples(std::vector< Vertex > &vertices) {
-	const int LAYERS = 36;
-	const float LAYER_OFFSET = 1.0f;
-	const int BOAT_TILES_X = 12;
-	const int BOAT_TILES_Y = 3;
-	const int UNDERWATER_LAYER = 7;
-	for (int i = 0; i <= UNDERWATER_LAYER; i++) {
-		float tilesetX = (i / BOAT_TILES_Y) * (1.0f / tileset_tiles.x);
-		float tilesetY = (i % BOAT_TILES_Y) * (1.0f / tileset_tiles.y);
-
-		glm::vec2 bob = glm::vec2(0.0f, 1.0f * glm::sin(5.0f + elapsed_time * 2.0f * glm::pi<float>() / BOB_TIME));
-		glm::vec2 layer_offset = glm::vec2(0.0f, i * -LAYER_OFFSET);
-
-		drawTexture(
-			vertices,
-			boat.position + bob + layer_offset - camera + 0.5f * (boat.size - boat.drawsize),
-			boat.drawsize,
-			glm::vec2(tilesetX, tilesetY),
-			glm::vec2(1.0f / tileset_tiles.x, 1.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			boat.rotation
-		);
+void BoatMode::writeBombSprites(size_t slot, bool live) {
+	const glm::u8vec4 white = glm::u8vec4(255, 255, 255, 255);
+	glm::vec2 position = glm::vec2(sim.bombs.x[slot], sim.bombs.y[slot]);
+	float phase = sim.bombs.bob_offset[slot] / (2.0f * glm::pi<float>());
+	glm::vec2 size = live ? glm::vec2(24.0f, 36.0f) : glm::vec2(0.0f); //(empty slots are zero-area)
+	glm::vec2 ripple_size = live ? glm::vec2(48.0f, 72.0f) : glm::vec2(0.0f);
+
+	//ripples (in time with the bob):
+	Sprite ripple = Sprite(position + glm::vec2(-18.0f, -46.0f), ripple_size, atlasRect(boat_atlas::bomb_ripple), white, glm::vec2(1.0f, 0.0f),
+		glm::vec4(phase, 0.0f, 1.0f / BOB_TIME, 0.0f), atlasFrames(boat_atlas::bomb_ripple));
+	//the bomb bobs, and its fuse flickers between its two frames (twice a second -- ten times per ANIMATION_PERIOD -- from the same phase):
+	Sprite bomb = Sprite(position + glm::vec2(-6.0f, -35.0f), size, atlasRect(boat_atlas::bomb), white, glm::vec2(1.0f, 0.0f),
+		glm::vec4(phase, 1.0f / BOB_TIME, 10.0f / ANIMATION_PERIOD, 1.0f), atlasFrames(boat_atlas::bomb));
+
+	//(obstacle_buffer must be bound to GL_ARRAY_BUFFER)
+	glBufferSubData(GL_ARRAY_BUFFER, (BOMB_RIPPLE_SPRITES + slot) * sizeof(Sprite), sizeof(ripple), &ripple);
+	glBufferSubData(GL_ARRAY_BUFFER, (BOMB_SPRITES + slot) * sizeof(Sprite), sizeof(bomb), &bomb);
+}
 
-		if (i == 7) {
-			glm::vec2 frameloc;
-			if ((int) ripple_frame == 0) frameloc = glm::vec2(4.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 1) frameloc = glm::vec2(6.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 2) frameloc = glm::vec2(8.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 3) frameloc = glm::vec2(10.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 4) frameloc = glm::vec2(4.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 5) frameloc = glm::vec2(6.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-			else if ((int) ripple_frame == 6) frameloc = glm::vec2(8.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-			else frameloc = glm::vec2(10.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-			drawTexture(
-				vertices,
-				boat.position + layer_offset + glm::vec2(-12.0f, -18.0f) - camera + 0.5f * (boat.size - boat.drawsize),
-				glm::vec2(48.0f, 72.0f),
-				frameloc,
-				glm::vec2(2.0f / tileset_tiles.x, 2.0f / tileset_tiles.y),
-				glm::u8vec4(255, 255, 255, 255),
-				boat.rotation
-			);
+void BoatMode::syncRiverbankMesh() {
+	//(a retry starts a new course, whose head row may be the same as the old one's if the game ended early)
+	bool rebuild = !riverbank_mesh_valid || sim.seed != riverbank_mesh_seed || sim.river_head.index < riverbank_mesh_newest_row;
+	if (!rebuild && sim.river_head.index == riverbank_mesh_newest_row) return; //(nothing generated)
+
+	glBindBuffer(GL_ARRAY_BUFFER, riverbank_buffer);
+
+	auto sync_bank = [&](auto const &bank, size_t b) {
+		if (rebuild) {
+			for (size_t slot = 0; slot < RIVERBANK_SLOTS; ++slot) {
+				writeRiverbankSlot(b, slot);
+			}
+		} else {
+			//slots retired since the last sync (now empty):
+			for (size_t slot = riverbank_mesh_head[b]; slot != bank.head; slot = (slot + 1) % RIVERBANK_SLOTS) {
+				writeRiverbankSlot(b, slot);
+			}
+			//vertices that cover rows generated since the last sync (the previous newest one, which got longer, and any new ones):
+			for (size_t i = bank.size(); i > 0 && bank.last_row(i - 1) >= riverbank_mesh_newest_row; --i) {
+				writeRiverbankSlot(b, bank.slot(i - 1));
+			}
 		}
-	}
-}
+		riverbank_mesh_head[b] = bank.head;
+	};
+	sync_bank(sim.riverbank_left, 0);
+	sync_bank(sim.riverbank_right, 1);
 
-void BoatMode::drawBoxRipples(std::vector< Vertex > &vertices) {
-	for (Box box: boxes) {
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		// draw underwater portion
-		glm::vec2 bob = glm::vec2(0.0f, glm::sin(box.bob_offset + elapsed_time * 2.0f * glm::pi<float>() / BOB_TIME));
+	riverbank_mesh_valid = true;
+	riverbank_mesh_seed = sim.seed;
+	riverbank_mesh_newest_row = sim.river_head.index;
 
-		drawTexture(
-			vertices,
-			box.position + glm::vec2(0.0f, 24.0f) + bob - camera,
-			glm::vec2(24.0f, 36.0f),
-			glm::vec2(0.0f, 4.0f / tileset_tiles.y),
-			glm::vec2(1.0f / tileset_tiles.x, 1.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			0.0f
-		);
+	GL_ERRORS();
+}
 
-		// draw ripples
-		glm::vec2 frameloc;
-		float box_ripple_frame = ripple_frame + box.bob_offset * ripple_frames / (2.0f * glm::pi<float>());
-		while (box_ripple_frame > ripple_frames) box_ripple_frame -= ripple_frames;
-		if ((int) box_ripple_frame == 0) frameloc = glm::vec2(4.0f / tileset_tiles.x, 7.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 1) frameloc = glm::vec2(6.0f / tileset_tiles.x, 7.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 2) frameloc = glm::vec2(8.0f / tileset_tiles.x, 7.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 3) frameloc = glm::vec2(10.0f / tileset_tiles.x, 7.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 4) frameloc = glm::vec2(4.0f / tileset_tiles.x, 9.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 5) frameloc = glm::vec2(6.0f / tileset_tiles.x, 9.0f / tileset_tiles.y);
-		else if ((int) box_ripple_frame == 6) frameloc = glm::vec2(8.0f / tileset_tiles.x, 9.0f / tileset_tiles.y);
-		else frameloc = glm::vec2(10.0f / tileset_tiles.x, 9.0f / tileset_tiles.y);
-		drawTexture(
-			vertices,
-			box.position + glm::vec2(-12.0f, -30.0f) - camera,
-			glm::vec2(48.0f, 72.0f),
-			frameloc,
-			glm::vec2(2.0f / tileset_tiles.x, 2.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			0.0f
-		);
+void BoatMode::syncRiverbankEdges() {
+	const int32_t rows = BoatSim::RIVERBANK_ROWS;
+	int32_t newest = sim.river_head.index;
+	int32_t first = sim.riverbank_first_row();
+	//(a retry starts a new course, whose head row may be the same as the old one's if the game ended early)
+	bool same_course = riverbank_edges_valid && sim.seed == riverbank_edges_seed;
+	if (same_course && newest == riverbank_edges_newest_row) return; //(nothing generated)
+	if (same_course && newest > riverbank_edges_newest_row) {
+		first = std::max(first, riverbank_edges_newest_row + 1);
+	} //else all kept rows (first sync, or river restarted)
+
+	glBindTexture(GL_TEXTURE_2D, riverbank_edges_tex);
+
+	//upload rows [first, newest] as runs that don't wrap around the end of the texture:
+	for (int32_t begin = first; begin <= newest; ) {
+		int32_t end = std::min(newest + 1, begin + (rows - begin % rows));
+		for (int32_t r = begin; r < end; ++r) {
+			glm::vec2 &edges = riverbank_edges_scratch[r - begin];
+			if (!sim.riverbank_x(RIVER_HEIGHT - r, &edges.x, &edges.y)) {
+				edges = glm::vec2(0.0f, float(RIVER_WIDTH)); //(not kept; shouldn't happen)
+			}
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, begin % rows, 0, end - begin, 1, GL_RG, GL_FLOAT, riverbank_edges_scratch);
+		begin = end;
 	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	riverbank_edges_valid = true;
+	riverbank_edges_seed = sim.seed;
+	riverbank_edges_newest_row = newest;
+
+	GL_ERRORS();
 }
 
-void BoatMode::drawBombRipples(std::vector< Vertex > &vertices) {
-	for (Bomb bomb: bombs) {
-		glm::vec2 frameloc;
-		float bomb_ripple_frames = 6.0f;
-		float bomb_ripple_frame = (ripple_frame * 6.0f / 8.0f) + bomb.bob_offset * bomb_ripple_frames / (2.0f * glm::pi<float>());
-		while (bomb_ripple_frame > bomb_ripple_frames) bomb_ripple_frame -= bomb_ripple_frames;
-		if ((int) bomb_ripple_frame == 0) frameloc = glm::vec2(12.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-		else if ((int) bomb_ripple_frame == 1) frameloc = glm::vec2(14.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-		else if ((int) bomb_ripple_frame == 2) frameloc = glm::vec2(16.0f / tileset_tiles.x, 3.0f / tileset_tiles.y);
-		else if ((int) bomb_ripple_frame == 3) frameloc = glm::vec2(12.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-		else if ((int) bomb_ripple_frame == 4) frameloc = glm::vec2(14.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-		else frameloc = glm::vec2(16.0f / tileset_tiles.x, 5.0f / tileset_tiles.y);
-		drawTexture(
-			vertices,
-			bomb.position + glm::vec2(-18.0f, -46.0f) - camera,
-			glm::vec2(48.0f, 72.0f),
-			frameloc,
-			glm::vec2(2.0f / tileset_tiles.x, 2.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			0.0f
-		);
+void BoatMode::writeRiverbankSlot(size_t b, size_t slot) {
+	//every bank row is drawn as a 1px tall top, 24px above the row, over a cliff that runs down to the row.
+	//the bank is straight along each polyline segment, so each segment is drawn as a few trapezoids
+	// (edges pass through the middle of each row's end pixel, so they rasterize exactly like per-row rectangles):
+	const float cliff_height = 24.0f;
+	const glm::vec2 cliff_texcoord = atlasTexel(boat_atlas::bank_cliff);
+	const glm::vec2 top_texcoord = atlasTexel(boat_atlas::bank_top);
+	const glm::u8vec4 color = glm::u8vec4(255, 255, 255, 255);
+
+	auto const &bank = (b == 0 ? sim.riverbank_left : sim.riverbank_right);
+	bool left = (b == 0);
+
+	riverbank_scratch.clear();
+
+	//part of the river between bank x and the edge of the river:
+	auto span = [&](float top, float x_top, float bottom, float x_bottom, glm::vec2 const &texcoord) {
+		glm::vec2 top_x = left ? glm::vec2(0.0f, x_top) : glm::vec2(x_top, RIVER_WIDTH);
+		glm::vec2 bottom_x = left ? glm::vec2(0.0f, x_bottom) : glm::vec2(x_bottom, RIVER_WIDTH);
+		drawTrapezoid(riverbank_scratch, top, top_x, bottom, bottom_x, texcoord, color);
+	};
+
+	size_t i = (slot + RIVERBANK_SLOTS - bank.head) % RIVERBANK_SLOTS;
+	if (i < bank.size()) {
+		int32_t r0 = bank.first_row(i);
+		int32_t r1 = bank.last_row(i);
+
+		//row r covers [y - 1, y) with y = RIVER_HEIGHT - r; tops are drawn 'cliff_height' above that:
+		float bottom = RIVER_HEIGHT - r0 - cliff_height;
+		float top = RIVER_HEIGHT - r1 - 1 - cliff_height;
+		float x_bottom = bank.x_at(i, r0 - 0.5f);
+		float x_top = bank.x_at(i, r1 + 0.5f);
+
+		//cliffs:
+		if (left ? x_bottom > x_top : x_bottom < x_top) {
+			//bank sticks out furthest at the bottom: cliff below each top, then the bottom row's cliff:
+			span(top, x_top, bottom, x_bottom, cliff_texcoord);
+			float x = bank.x_at(i, float(r0));
+			span(bottom, x, bottom + cliff_height, x, cliff_texcoord);
+		} else {
+			//bank sticks out furthest at the top: the top row's cliff, then the rows themselves:
+			float x = bank.x_at(i, float(r1));
+			span(top, x, top + cliff_height, x, cliff_texcoord);
+			span(top + cliff_height, x_top, bottom + cliff_height, x_bottom, cliff_texcoord);
+		}
+		//top:
+		span(top, x_top, bottom, x_bottom, top_texcoord);
+	} else {
+		//unused slot; zero-area quads:
+		for (uint32_t q = 0; q < 3; ++q) {
+			drawTrapezoid(riverbank_scratch, 0.0f, glm::vec2(0.0f), 0.0f, glm::vec2(0.0f), top_texcoord, color);
+		}
 	}
+	assert(riverbank_scratch.size() == 12);
+
+	//(riverbank_buffer must be bound to GL_ARRAY_BUFFER)
+	size_t cliff_quad = (b * RIVERBANK_SLOTS + slot) * 2;
+	size_t top_quad = RIVERBANK_CLIFF_QUADS + b * RIVERBANK_SLOTS + slot;
+	glBufferSubData(GL_ARRAY_BUFFER, cliff_quad * 4 * sizeof(Vertex), 8 * sizeof(Vertex), riverbank_scratch.data());
+	glBufferSubData(GL_ARRAY_BUFFER, top_quad * 4 * sizeof(Vertex), 4 * sizeof(Vertex), riverbank_scratch.data() + 8);
 }
 
-void BoatMode::drawBoat(std::vector< Vertex > &vertices) {
-	const int LAYERS = 36;
-	const float LAYER_OFFSET = 1.0f;
-	const int BOAT_TILES_X = 12;
-	const int BOAT_TILES_Y = 3;
-	const int UNDERWATER_LAYER = 7;
-	for (int i = UNDERWATER_LAYER + 1; i < LAYERS; i++) {
-		float tilesetX = (i / BOAT_TILES_Y) * (1.0f / tileset_tiles.x);
-		float tilesetY = (i % BOAT_TILES_Y) * (1.0f / tileset_tiles.y);
-
-		glm::vec2 bob = glm::vec2(0.0f, 1.0f * glm::sin(5.0f + elapsed_time * 2.0f * glm::pi<float>() / BOB_TIME));
-		glm::vec2 layer_offset = glm::vec2(0.0f, i * -LAYER_OFFSET);
-
-		drawTexture(
-			vertices,
-			boat.position + bob + layer_offset - camera + 0.5f * (boat.size - boat.drawsize),
-			boat.drawsize,
-			glm::vec2(tilesetX, tilesetY),
-			glm::vec2(1.0f / tileset_tiles.x, 1.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			boat.rotation
-		);
+uint64_t BoatMode::renderKey(Layer layer, RenderProgram program, RenderTexture texture, uint32_t depth) {
+	assert(depth < (1u << 24));
+	return (uint64_t(layer) << 56) | (uint64_t(program) << 48) | (uint64_t(texture) << 40) | (uint64_t(depth) << 16);
+}
+static BoatMode::Layer render_key_layer(uint64_t key) { return BoatMode::Layer((key >> 56) & 0xff); }
+static BoatMode::RenderProgram render_key_program(uint64_t key) { return BoatMode::RenderProgram((key >> 48) & 0xff); }
+static BoatMode::RenderTexture render_key_texture(uint64_t key) { return BoatMode::RenderTexture((key >> 40) & 0xff); }
+
+void BoatMode::queueSprites(Layer layer, RenderTexture texture, size_t begin, size_t end, uint32_t depth) {
+	uint64_t key = renderKey(layer, SpriteStream, texture, depth);
+	for (size_t i = begin; i < end; ++i) {
+		render_queue.emplace_back(RenderCommand{key, uint32_t(i), 1});
 	}
 }
 
-void BoatMode::drawBoxes(std::vector< Vertex > &vertices) {
-	for (Box box : boxes) {
-		glm::vec2 bob = glm::vec2(0.0f, glm::sin(box.bob_offset + elapsed_time * 2.0f * glm::pi<float>() / BOB_TIME));
+void BoatMode::queueDraw(Layer layer, RenderProgram program, RenderTexture texture, uint32_t depth, size_t first, size_t count) {
+	if (count == 0) return;
+	render_queue.emplace_back(RenderCommand{renderKey(layer, program, texture, depth), uint32_t(first), uint32_t(count)});
+}
 
-		drawTexture(
-			vertices,
-			box.position + glm::vec2(0.0f, -12.0f) + bob - camera,
-			glm::vec2(24.0f, 36.0f),
-			glm::vec2(0.0f, 3.0f / tileset_tiles.y),
-			glm::vec2(1.0f / tileset_tiles.x, 1.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			0.0f
-		);
+void BoatMode::sortRenderQueue() {
+	if (render_queue.empty()) return;
+	//least-significant-digit radix sort, a byte at a time (every pass is stable, so the sort is too),
+	// skipping bytes that are the same in every key (most of them, with only a few layers, programs, and textures):
+	render_queue_scratch.resize(render_queue.size());
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		size_t counts[256] = {};
+		for (RenderCommand const &command : render_queue) {
+			++counts[(command.key >> shift) & 0xff];
+		}
+		if (counts[(render_queue[0].key >> shift) & 0xff] == render_queue.size()) continue;
+
+		//counts to starting positions:
+		size_t offset = 0;
+		for (size_t &count : counts) {
+			size_t c = count;
+			count = offset;
+			offset += c;
+		}
+		for (RenderCommand const &command : render_queue) {
+			render_queue_scratch[counts[(command.key >> shift) & 0xff]++] = command;
+		}
+		render_queue.swap(render_queue_scratch);
 	}
 }
 
-void BoatMode::drawBombs(std::vector< Vertex > &vertices) {
-	for (Bomb bomb : bombs) {
-		glm::vec2 bob = glm::vec2(0.0f, glm::sin(bomb.bob_offset + elapsed_time * 2.0f * glm::pi<float>() / BOB_TIME));
-
-		float frame = (float) (int) (2.0f + 0.5f * (glm::sin(bomb.bob_offset + elapsed_time * 12.0f)));
-		drawTexture(
-			vertices,
-			bomb.position + glm::vec2(-6.0f, -35.0f) + bob - camera,
-			glm::vec2(24.0f, 36.0f),
-			glm::vec2(frame / tileset_tiles.x, 3.0f / tileset_tiles.y),
-			glm::vec2(1.0f / tileset_tiles.x, 1.0f / tileset_tiles.y),
-			glm::u8vec4(255, 255, 255, 255),
-			0.0f
-		);
-	}
+//calls fn(first, count) for each of the (one or two) runs of slots that hold 'count' ring buffer elements
+// starting at slot 'first', wrapping at 'capacity':
+template< typename F >
+static void for_slot_runs(size_t first, size_t count, size_t capacity, F const &fn) {
+	size_t run = std::min(count, capacity - first);
+	if (run != 0) fn(first, run);
+	if (count > run) fn(size_t(0), count - run);
 }
 
 void BoatMode::draw(glm::uvec2 const &drawable_size) {
@@ -619,91 +892,168 @@ void BoatMode::draw(glm::uvec2 const &drawable_size) {
 	const float shadow_offset = 0.07f;
 	const float padding = 0.14f; //padding between outside of walls and edge of window
 
-	//---- compute vertices to draw ----
+	//---- blend previous and current tick ----
 
-	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
-	
-	std::vector< Vertex > vertices;
-
-	//inline helper function for rectangle drawing:
-	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
-		//draw rectangle as two CCW-oriented triangles:
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
+	draw_boat_position = glm::mix(prev_boat_position, sim.boat.position, tick_alpha);
+	draw_boat_rotation = glm::mix(prev_boat_rotation, sim.boat.rotation, tick_alpha);
+	draw_camera = glm::mix(prev_camera, sim.camera, tick_alpha);
+	draw_time = elapsed_time + tick_alpha * Mode::Tick;
+	draw_ripple_frame = ripple_frame + ripple_frames * tick_alpha * Mode::Tick / BOB_TIME;
+	while (draw_ripple_frame >= ripple_frames) draw_ripple_frame -= ripple_frames;
+
+	//---- view culling ----
+
+	//only obstacles and riverbank rows within VIEW_MARGIN of the view are drawn
+	// (the margin covers sprites drawn up to 46 pixels from their obstacle's position, and the 24 pixel cliffs):
+	const float VIEW_MARGIN = 64.0f;
+	float view_min_y = draw_camera.y - VIEW_MARGIN;
+	float view_max_y = draw_camera.y + RIVER_HEIGHT + VIEW_MARGIN;
+
+	//obstacles are sorted by decreasing y, so the visible ones are a run of the pool:
+	struct SlotRange {
+		size_t first = 0; //slot of the first element
+		size_t count = 0;
+	};
+	auto visible_obstacles = [&](auto const &pool) {
+		//index of the first obstacle above 'y':
+		auto first_above = [&pool](float y) {
+			size_t begin = 0;
+			size_t end = pool.size();
+			while (begin < end) {
+				size_t mid = begin + (end - begin) / 2;
+				if (pool.y[pool.slot(mid)] >= y) begin = mid + 1;
+				else end = mid;
+			}
+			return begin;
+		};
+		size_t begin = first_above(view_max_y);
+		size_t end = first_above(view_min_y);
+		SlotRange range;
+		if (begin < end) {
+			range.first = pool.slot(begin);
+			range.count = end - begin;
+		}
+		return range;
 	};
+	SlotRange visible_boxes = visible_obstacles(sim.boxes);
+	SlotRange visible_bombs = visible_obstacles(sim.bombs);
+
+	//riverbank polyline vertices whose rows (row r covers y in [RIVER_HEIGHT - r - 1, RIVER_HEIGHT - r)) are in view:
+	// (the shader path needs no culling; it only ever looks at the rows under each pixel)
+	int32_t view_min_row = int32_t(std::floor(RIVER_HEIGHT - view_max_y));
+	int32_t view_max_row = int32_t(std::ceil(RIVER_HEIGHT - view_min_y));
+	auto visible_vertices = [&](auto const &bank) {
+		SlotRange range;
+		if (bank.empty()) return range;
+		int32_t r0 = std::max(view_min_row, bank.oldest_row());
+		int32_t r1 = std::min(view_max_row, bank.newest());
+		if (r0 > r1) return range;
+		size_t begin = size_t(bank.find(r0));
+		size_t end = size_t(bank.find(r1)) + 1;
+		range.first = bank.slot(begin);
+		range.count = end - begin;
+		return range;
+	};
+	SlotRange visible_banks[2] = { visible_vertices(sim.riverbank_left), visible_vertices(sim.riverbank_right) };
 
-	drawBoatRipples(vertices);
-	drawBoxRipples(vertices);
-	drawBombRipples(vertices);
-	drawBoxes(vertices);
-	drawBombs(vertices);
-	
+	//---- queue everything to draw ----
 
-	for (int i = 0; i < RIVERBANK_BUFFER_LENGTH; i++) {
-		RiverbankPoint p = riverbank[i];
-		glm::vec2 offset(0.0f, 24.0f);
-		drawTexture(vertices, glm::vec2(0, p.position_left.y - 1) - camera - offset, glm::vec2(p.position_left.x, 1) + offset, glm::vec2(2.0f / tileset_size.x, 390.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(255, 255, 255, 255), 0.0f);
-		drawTexture(vertices, glm::vec2(p.position_right.x, p.position_right.y - 1) - camera - offset, glm::vec2(RIVER_WIDTH, 1) + offset, glm::vec2(2.0f / tileset_size.x, 390.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(255, 255, 255, 255), 0.0f);
-	}
+	//sprites are accumulated into this list, and everything drawn (sprites, and ranges of the buffers kept on the GPU)
+	// is queued into render_queue, to be sorted and drawn at the end of this function:
+	// (both are kept between frames, so after the first few frames this doesn't allocate)
+	sprites.clear();
+	render_queue.clear();
+
+	{ //boat (the lower stack is the first sprite drawBoatRipples() draws; the upper stack is drawn by drawBoat()):
+		size_t begin = sprites.size();
+		drawBoatRipples(sprites);
+		queueSprites(BoatUnderwaterLayer, BoatStackTexture, begin, begin + 1);
+		queueSprites(BoatRippleLayer, TilesetTexture, begin + 1, sprites.size());
 
-	for (int i = 0; i < RIVERBANK_BUFFER_LENGTH; i++) {
-		RiverbankPoint p = riverbank[i];
-		glm::vec2 offset(0.0f, 24.0f);
-		drawTexture(vertices, glm::vec2(0, p.position_left.y - 1) - camera - offset, glm::vec2(p.position_left.x, 1), glm::vec2(8.0f / tileset_size.x, 390.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(255, 255, 255, 255), 0.0f);
-		drawTexture(vertices, glm::vec2(p.position_right.x, p.position_right.y - 1) - camera - offset, glm::vec2(RIVER_WIDTH, 1), glm::vec2(8.0f / tileset_size.x, 390.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(255, 255, 255, 255), 0.0f);
+		begin = sprites.size();
+		drawBoat(sprites);
+		queueSprites(BoatLayer, BoatStackTexture, begin, sprites.size());
 	}
 
-	drawBoat(vertices);
+	//obstacles in view (obstacle_buffer is kept up to date by update()), by group in drawing order:
+	auto queue_obstacles = [&](SlotRange const &range, size_t capacity, uint32_t depth, size_t group, size_t per_slot) {
+		for_slot_runs(range.first, range.count, capacity, [&](size_t first, size_t count) {
+			queueDraw(ObstacleLayer, ObstacleSprites, TilesetTexture, depth, group + per_slot * first, per_slot * count);
+		});
+	};
+	queue_obstacles(visible_boxes, BoatSim::MAX_BOXES, 0, BOX_RIPPLE_SPRITES, 2);
+	queue_obstacles(visible_bombs, BoatSim::MAX_BOMBS, 1, BOMB_RIPPLE_SPRITES, 1);
+	queue_obstacles(visible_boxes, BoatSim::MAX_BOXES, 2, BOX_SPRITES, 1);
+	queue_obstacles(visible_bombs, BoatSim::MAX_BOMBS, 3, BOMB_SPRITES, 1);
+
+	if (draw_riverbanks_with_shader) {
+		//riverbanks (one full-screen quad; each pixel checks the rows whose top or cliff could cover it):
+		queueDraw(RiverbankLayer, RiverbankShader, TilesetTexture, 0, 0, 1);
+	} else {
+		//riverbanks (the cliffs of the slots in view, then their tops):
+		for (size_t b = 0; b < 2; ++b) {
+			for_slot_runs(visible_banks[b].first, visible_banks[b].count, RIVERBANK_SLOTS, [&](size_t first, size_t count) {
+				queueDraw(RiverbankLayer, RiverbankMesh, TilesetTexture, 0, 2 * (b * RIVERBANK_SLOTS + first), 2 * count);
+				queueDraw(RiverbankLayer, RiverbankMesh, TilesetTexture, 1, RIVERBANK_CLIFF_QUADS + b * RIVERBANK_SLOTS + first, count);
+			});
+		}
+	}
 
-	if (game_over) {
-		drawTexture(vertices, glm::vec2(0, 0), glm::vec2(RIVER_WIDTH, RIVER_HEIGHT), glm::vec2(15.0f / tileset_size.x, 390.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(0, 0, 0, 128), 0.0f);
+	if (sim.game_over) {
+		size_t begin = sprites.size();
+		glm::vec4 shade = atlasRect(boat_atlas::shade);
+		drawTexture(sprites, glm::vec2(0, 0), glm::vec2(RIVER_WIDTH, RIVER_HEIGHT), glm::vec2(shade.x, shade.y), glm::vec2(shade.z, shade.w), glm::u8vec4(0, 0, 0, 128));
+		queueSprites(OverlayLayer, TilesetTexture, begin, sprites.size());
+	}
 
-		{
-			std::string game_over_text = "GAME";
-			float width = ((float) game_over_text.size()) * 12.0f * 4.0f;
-			drawText(vertices, game_over_text, glm::vec2(0.5f * (RIVER_WIDTH - width), 0.5f * RIVER_HEIGHT - 128.0f), 4.0f, glm::u8vec4(255, 0, 0, 255));
-		}
-		
-		{
-			std::string game_over_text = "OVER";
-			float width = ((float) game_over_text.size()) * 12.0f * 4.0f;
-			drawText(vertices, game_over_text, glm::vec2(0.5f * (RIVER_WIDTH - width), 0.5f * RIVER_HEIGHT - 64.0f), 4.0f, glm::u8vec4(255, 0, 0, 255));
-		}
+	{ //text:
+		size_t begin = sprites.size();
 
-		{
-			std::stringstream stream;
-			stream << "SCORE " << std::fixed << std::setprecision(0) << score << "M";
-			std::string score_text = stream.str();
-			float width = ((float) score_text.size()) * 24.0f;
-			drawText(vertices, score_text, glm::vec2(0.5f * (RIVER_WIDTH - width),  0.5f * RIVER_HEIGHT), 2.0f, glm::u8vec4(255, 255, 255, 255));
+		//text is centered across the river, 12 pixels per character at scale 1:
+		auto draw_centered = [&](Text which, char const *text, size_t length, float y, float scale, glm::u8vec4 color) {
+			float width = float(length) * 12.0f * scale;
+			drawText(sprites, which, text, length, glm::vec2(0.5f * (RIVER_WIDTH - width), y), scale, color);
+		};
+		//(score is shown rounded to the nearest meter, clamped so the conversion to uint32_t is always defined)
+		uint32_t score_meters = uint32_t(glm::clamp(std::floor(sim.score + 0.5f), 0.0f, 1e9f));
+
+		if (sim.game_over) {
+			draw_centered(GameText, "GAME", std::strlen("GAME"), 0.5f * RIVER_HEIGHT - 128.0f, 4.0f, glm::u8vec4(255, 0, 0, 255));
+			draw_centered(OverText, "OVER", std::strlen("OVER"), 0.5f * RIVER_HEIGHT - 64.0f, 4.0f, glm::u8vec4(255, 0, 0, 255));
+			{
+				char score_text[TextMesh::MaxLength] = "SCORE ";
+				static_assert(6 + 10 + 1 <= TextMesh::MaxLength, "room for 'SCORE ', ten digits, and 'M'");
+				size_t length = 6;
+				length += format_uint(score_meters, score_text + length);
+				score_text[length++] = 'M';
+				draw_centered(FinalScoreText, score_text, length, 0.5f * RIVER_HEIGHT, 2.0f, glm::u8vec4(255, 255, 255, 255));
+			}
+			draw_centered(PressSpaceText, "PRESS SPACE", std::strlen("PRESS SPACE"), RIVER_HEIGHT - 96.0f, 2.0f, glm::u8vec4(255, 255, 255, 255));
+			draw_centered(RetryText, "TO RETRY", std::strlen("TO RETRY"), RIVER_HEIGHT - 64.0f, 2.0f, glm::u8vec4(255, 255, 255, 255));
+		} else {
+			char score_text[TextMesh::MaxLength];
+			size_t length = format_uint(score_meters, score_text);
+			score_text[length++] = 'M';
+			draw_centered(ScoreText, score_text, length, 24.0f, 2.0f, glm::u8vec4(255, 255, 255, 255));
 		}
 
-		{
-			std::string press_space_text = "PRESS SPACE";
-			float width = ((float) press_space_text.size()) * 12.0f * 2.0f;
-			drawText(vertices, press_space_text, glm::vec2(0.5f * (RIVER_WIDTH - width), RIVER_HEIGHT - 96.0f), 2.0f, glm::u8vec4(255, 255, 255, 255));
-		}
-		{
-			std::string retry_text = "TO RETRY";
-			float width = ((float) retry_text.size()) * 12.0f * 2.0f;
-			drawText(vertices, retry_text, glm::vec2(0.5f * (RIVER_WIDTH - width), RIVER_HEIGHT - 64.0f), 2.0f, glm::u8vec4(255, 255, 255, 255));
-		}
-		
-	} else {
-		std::stringstream stream;
-		stream << std::fixed << std::setprecision(0) << score << "M";
-		std::string score_text = stream.str();
-		float width = ((float) score_text.size()) * 24.0f;
-		drawText(vertices, score_text, glm::vec2(0.5f * (RIVER_WIDTH - width), 24.0f), 2.0f, glm::u8vec4(255, 255, 255, 255));
+		queueSprites(TextLayer, TilesetTexture, begin, sprites.size());
 	}
 
 	// boat hitbox
-	//drawTexture(vertices, boat.position - camera, boat.size, glm::vec2(8.0f / tileset_size.x, 150.0f / tileset_size.y), 1.0f / tileset_size, glm::u8vec4(255, 0, 0, 255), 0.0f);
+	//drawTexture(sprites, draw_boat_position - draw_camera, sim.boat.size, glm::vec2(atlasRect(boat_atlas::bank_top)), glm::vec2(0.0f), glm::u8vec4(255, 0, 0, 255));
+
+	//---- sort the queue ----
+
+	sortRenderQueue();
+
+	//queued sprites are copied into sorted_sprites in drawing order (so runs of them can be drawn as one instanced draw):
+	sorted_sprites.clear();
+	for (RenderCommand &command : render_queue) {
+		if (render_key_program(command.key) != SpriteStream) continue;
+		sorted_sprites.emplace_back(sprites[command.first]);
+		command.first = uint32_t(sorted_sprites.size() - 1);
+	}
 
 	//compute window scale matrix
 	glm::mat4 pixels_to_clip = glm::mat4(
@@ -717,6 +1067,11 @@ void BoatMode::draw(glm::uvec2 const &drawable_size) {
 
 	//---- actual drawing ----
 
+	//the scene is drawn into scene_framebuffer, one pixel per game pixel
+	// (so the cost of all the blended layers doesn't grow with the window):
+	glBindFramebuffer(GL_FRAMEBUFFER, scene_framebuffer);
+	glViewport(0, 0, RIVER_WIDTH, RIVER_HEIGHT);
+
 	//clear the color buffer:
 	glClearColor(bg_color.r / 255.0f, bg_color.g / 255.0f, bg_color.b / 255.0f, bg_color.a / 255.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -727,29 +1082,137 @@ void BoatMode::draw(glm::uvec2 const &drawable_size) {
 	//don't use the depth test:
 	glDisable(GL_DEPTH_TEST);
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW); //upload vertices array
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//upload sprites to this frame's region of sprite_buffer:
+	size_t first_sprite = sprite_buffer.upload(sorted_sprites.data(), sorted_sprites.size());
 
-	//set color_texture_program as current program:
+	//the river (riverbank_buffer, obstacle_buffer, and the boat) is drawn in river coordinates, so the camera is applied with the clip offset:
+	glm::vec4 river_clip_offset = pixels_clip_offset - pixels_to_clip * glm::vec4(draw_camera, 0.0f, 0.0f);
 	glUseProgram(color_texture_program.program);
-
-	//upload OBJECT_TO_CLIP to the proper uniform location:
 	glUniformMatrix4fv(color_texture_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(pixels_to_clip));
-	glUniform4fv(color_texture_program.CLIP_OFFSET_vec4, 1, glm::value_ptr(pixels_clip_offset));
+	glUniform4fv(color_texture_program.CLIP_OFFSET_vec4, 1, glm::value_ptr(river_clip_offset));
 
-	//use the mapping vertex_buffer_for_color_texture_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_texture_program);
+	glUseProgram(sprite_program.program);
+	glUniformMatrix4fv(sprite_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(pixels_to_clip));
+	glUniform1f(sprite_program.TIME_float, draw_time);
 
-	//bind the solid white texture to location zero so things will be drawn just with their colors:
+	glUseProgram(riverbank_program.program);
+	//gl_FragCoord (scene_framebuffer pixels) to river coordinates, with y measured from row 0 (RIVER_HEIGHT) and the camera included:
+	glm::vec4 frag_to_river = glm::vec4(
+		1.0f, -1.0f,
+		draw_camera.x, draw_camera.y
+	);
+	glUniform4fv(riverbank_program.FRAG_TO_RIVER_vec4, 1, glm::value_ptr(frag_to_river));
+	glUniform1i(riverbank_program.ROWS_int, BoatSim::RIVERBANK_ROWS);
+	glUniform1i(riverbank_program.NEWEST_ROW_int, riverbank_edges_newest_row);
+	glUniform1i(riverbank_program.CLIFF_HEIGHT_int, 24);
+	glUniform2fv(riverbank_program.CLIFF_TEXCOORD_vec2, 1, glm::value_ptr(atlasTexel(boat_atlas::bank_cliff)));
+	glUniform2fv(riverbank_program.TOP_TEXCOORD_vec2, 1, glm::value_ptr(atlasTexel(boat_atlas::bank_top)));
+
+	//textures are sampled from unit zero, and the tileset's palette from unit two
+	// (riverbank_program also reads the bank edges from unit one):
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, riverbank_edges_tex);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, palette_tex);
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tileset_tex);
 
-	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	//draw the queue in order, each command merged with the ones after it that continue the same draw
+	// (same program, texture, and space, and the next elements of the same buffer):
+	GLuint bound_program = 0;
+	int bound_texture = -1;
+	int sprite_space = -1; //(0 = river, 1 = screen; which CLIP_OFFSET sprite_program has)
+	int sprite_indexed = -1; //(whether sprite_program's INDEXED is set)
+	for (size_t i = 0; i < render_queue.size(); ) {
+		RenderCommand const &command = render_queue[i];
+		RenderProgram program = render_key_program(command.key);
+		RenderTexture texture = render_key_texture(command.key);
+		int space = (render_key_layer(command.key) >= OverlayLayer ? 1 : 0);
+
+		size_t count = command.count;
+		size_t next = i + 1;
+		while (next < render_queue.size()) {
+			RenderCommand const &after = render_queue[next];
+			if (render_key_program(after.key) != program || render_key_texture(after.key) != texture) break;
+			if ((render_key_layer(after.key) >= OverlayLayer ? 1 : 0) != space) break;
+			if (program == RiverbankShader || after.first != command.first + count) break;
+			count += after.count;
+			++next;
+		}
+		i = next;
+
+		GLuint gl_program = (program == RiverbankMesh ? color_texture_program.program
+			: program == RiverbankShader ? riverbank_program.program : sprite_program.program);
+		if (gl_program != bound_program) {
+			glUseProgram(gl_program);
+			bound_program = gl_program;
+		}
+		if (int(texture) != bound_texture) {
+			glBindTexture(GL_TEXTURE_2D, texture == BoatStackTexture ? boat_stack_tex : tileset_tex);
+			bound_texture = int(texture);
+		}
+		if (gl_program == sprite_program.program && space != sprite_space) {
+			glUniform4fv(sprite_program.CLIP_OFFSET_vec4, 1, glm::value_ptr(space ? pixels_clip_offset : river_clip_offset));
+			sprite_space = space;
+		}
+		//(the tileset holds palette indices; boat_stack_tex holds colors)
+		int indexed = (texture == TilesetTexture ? 1 : 0);
+		if (gl_program == sprite_program.program && indexed != sprite_indexed) {
+			glUniform1i(sprite_program.INDEXED_bool, indexed);
+			sprite_indexed = indexed;
+		}
+
+		if (program == SpriteStream) {
+			drawSprites(sprite_buffer.buffer, first_sprite + command.first, count);
+		} else if (program == ObstacleSprites) {
+			drawSprites(obstacle_buffer, command.first, count);
+		} else if (program == RiverbankMesh) {
+			glBindVertexArray(riverbank_buffer_for_color_texture_program);
+			draw_quads(GLint(4 * command.first), count);
+		} else if (program == RiverbankShader) {
+			glBindVertexArray(empty_vertex_array);
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		}
+	}
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	//sprite_buffer can reuse this frame's region once these draws are done:
+	sprite_buffer.fence();
+
+	//---- present ----
+
+	//scale the scene up by the largest whole number that fits in the drawable, centered, with black bars around it
+	// (windows smaller than the scene get it shrunk to fit instead):
+	glm::ivec2 scene_size = glm::ivec2(RIVER_WIDTH, RIVER_HEIGHT);
+	glm::ivec2 present_size;
+	int scale = std::min(int(drawable_size.x) / RIVER_WIDTH, int(drawable_size.y) / RIVER_HEIGHT);
+	if (scale >= 1) {
+		present_size = scene_size * scale;
+	} else {
+		float fit = std::min(float(drawable_size.x) / RIVER_WIDTH, float(drawable_size.y) / RIVER_HEIGHT);
+		present_size = glm::max(glm::ivec2(glm::vec2(scene_size) * fit), glm::ivec2(1));
+	}
+	glm::ivec2 present_min = (glm::ivec2(drawable_size) - present_size) / 2;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, drawable_size.x, drawable_size.y);
+
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, scene_framebuffer);
+	glBlitFramebuffer(
+		0, 0, scene_size.x, scene_size.y,
+		present_min.x, present_min.y, present_min.x + present_size.x, present_min.y + present_size.y,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST
+	);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 
-	//unbind the solid white texture:
+	//unbind the texture:
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	//reset vertex array to none:
@@ -1,4 +1,10 @@
 #include "ColorTextureProgram.hpp"
+#include "SpriteProgram.hpp"
+#include "RiverbankProgram.hpp"
+#include "StreamBuffer.hpp"
+#include "BoatSim.hpp"
+#include "Replay.hpp"
+#include "boat_atlas.hpp"
 
 #include "Mode.hpp"
 #include "GL.hpp"
@@ -8,97 +14,65 @@
 #include <glm/glm.hpp>
 
 #include <vector>
-#include <list>
 #include <deque>
 
 /*
  * BoatMode is a game mode that implements a single-player infinite runner boating game
+ * (game rules are in BoatSim; BoatMode feeds it keyboard input and draws it)
  */
 
 struct BoatMode : Mode {
-	BoatMode();
+	BoatMode(uint32_t seed);
 	virtual ~BoatMode();
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
 	virtual void update(float elapsed) override;
+	virtual void interpolate(float alpha) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
 
-	void reset_level();
-
 	//----- constants -----
-	static const int RIVER_WIDTH = 312;
-	static const int RIVER_HEIGHT = 480;
-
-	const float START_Y = RIVER_HEIGHT - 72.0f;
-
-	const float MAX_CAMERA_SPEED = 150.0f;
-	const float CAMERA_START_SPEED = 60.0f;
-	const float CAMERA_ACCEL_ZONE = RIVER_HEIGHT * 0.5f;
-	
-	const float ROTATION_SPEED = 5.0f;
-	const float MOVE_SPEED = 180.0f;
-	const float ACCEL_SPEED = 400.0f;
+	static const int RIVER_WIDTH = BoatSim::RIVER_WIDTH;
+	static const int RIVER_HEIGHT = BoatSim::RIVER_HEIGHT;
 
 	//----- game state -----
 
-	struct Boat {
-		Boat(glm::vec2 const &position_, glm::vec2 const &size_, glm::vec2 const &draw_size_, glm::vec2 const &velocity_, float const &rotation_) :
-			position(position_), size(size_), drawsize(draw_size_), velocity(velocity_), rotation(rotation_) { }
-		glm::vec2 position;
-		glm::vec2 size;
-		glm::vec2 drawsize;
-		glm::vec2 velocity;
-		float rotation;
-	};
+	//the simulation (boat, obstacles, river, camera, score) lives in BoatSim:
+	BoatSim sim;
 
-	struct Box {
-		Box(glm::vec2 const &position_, glm::vec2 const &size_, float const &bob_offset_) :
-			position(position_), size(size_), bob_offset(bob_offset_) { }
-		glm::vec2 position;
-		glm::vec2 size;
-		float bob_offset;
-	};
+	//----- replay -----
+	//seed and every tick's input so far (enough to reproduce this run):
+	Replay recording;
 
-	struct Bomb {
-		Bomb(glm::vec2 const &position_, glm::vec2 const &size_, float const &bob_offset_) :
-			position(position_), size(size_), bob_offset(bob_offset_) { }
-		glm::vec2 position;
-		glm::vec2 size;
-		float bob_offset;
-	};
+	//when 'playing_back', input comes from 'playback' instead of the keyboard,
+	// and the mode exits (sets Mode::current to null) after the last recorded tick:
+	bool playing_back = false;
+	Replay playback;
+	size_t playback_tick = 0;
 
-	struct RiverbankPoint {
-		glm::vec2 position_left;
-		float momentum_left;
-		glm::vec2 position_right;
-		float momentum_right;
-	};
-
-	Boat boat;
+	//----- animation -----
 	float ripple_frame = 0.0f;
 	float ripple_frames = 8.0f;
 	const float BOB_TIME = 1.25f; // period of 1 bob
+	//elapsed_time wraps at ANIMATION_PERIOD, so it stays precise however long the game runs
+	// (every animation -- bobs, ripples, the fuse flicker -- must complete a whole number of cycles in this period):
+	const float ANIMATION_PERIOD = 4.0f * BOB_TIME;
 	float elapsed_time = 0.0f;
-	std::list< Box > boxes;
-	std::vector< Bomb > bombs;
-	float score = 0.0f;
-	bool game_over = false;
-
-	static const int MIN_NORMAL_RIVER_WIDTH = 156;
-	static const int START_NORMAL_RIVER_WIDTH = RIVER_WIDTH;
-	static const int MIN_RIVER_WIDTH = 108;
-	float normal_river_width = START_NORMAL_RIVER_WIDTH;
-	static const int RIVERBANK_GENERATE = RIVER_HEIGHT - 32;
-	static const int RIVERBANK_BUFFER_LENGTH = RIVER_HEIGHT * 2;
-	int riverbank_last;
-	bool riverbank_empty = true;
-	RiverbankPoint riverbank[RIVERBANK_BUFFER_LENGTH]; // river bank ring buffer
-
-
-	glm::vec2 camera = glm::vec2(0.0f, 0.0f);
-	float camera_speed = CAMERA_START_SPEED;
-	bool camera_started = false;
+
+	//----- interpolation -----
+	//sim state as of the previous tick:
+	glm::vec2 prev_boat_position;
+	float prev_boat_rotation;
+	glm::vec2 prev_camera;
+	//fraction of a tick since the last update (from interpolate()):
+	float tick_alpha = 0.0f;
+
+	//blend of the previous and current tick, computed at the start of draw() and used by the draw functions:
+	glm::vec2 draw_boat_position;
+	float draw_boat_rotation;
+	glm::vec2 draw_camera;
+	float draw_time;
+	float draw_ripple_frame;
 
 	//----- music -----
 	Sound::Sample music;
@@ -115,39 +89,232 @@ struct BoatMode : Mode {
 	};
 	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "BoatMode::Vertex should be packed");
 
+	//rectangles (sprites) are drawn one instance each, from records defined as follows:
+	struct Sprite {
+		Sprite(glm::vec2 const &Position_, glm::vec2 const &Size_, glm::vec4 const &TexRect_, glm::u8vec4 const &Color_, glm::vec2 const &Rotation_,
+			glm::vec4 const &Cycle_ = glm::vec4(0.0f), glm::vec4 const &Frames_ = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)) :
+			Position(Position_), Size(Size_), TexRect(TexRect_), Color(Color_), Rotation(Rotation_), Cycle(Cycle_), Frames(Frames_) { }
+		glm::vec2 Position;
+		glm::vec2 Size;
+		glm::vec4 TexRect;
+		glm::u8vec4 Color;
+		glm::vec2 Rotation; //(cos, sin) of the rotation angle, so the shader needn't compute them per corner
+		glm::vec4 Cycle; //bob and animation frame, worked out by the shader (see SpriteProgram.hpp)
+		glm::vec4 Frames;
+	};
+	static_assert(sizeof(Sprite) == 4*2 + 4*2 + 4*4 + 1*4 + 4*2 + 4*4 + 4*4, "BoatMode::Sprite should be packed");
+
 	//Shader program that draws transformed, vertices tinted with vertex colors:
 	ColorTextureProgram color_texture_program;
 
-	//Buffer used to hold vertex data during drawing:
-	GLuint vertex_buffer = 0;
+	//Shader program that draws Sprites:
+	SpriteProgram sprite_program;
+
+	//riverbank geometry (in river coordinates; the camera is applied by CLIP_OFFSET when drawing).
+	//it stays on the GPU and is only rewritten where rows were generated (see syncRiverbankMesh()):
+	// each polyline vertex slot of each bank has a fixed place: two cliff quads in the first part
+	// of the buffer and one top quad in the second part (so every cliff is drawn under every top)
+	static const size_t RIVERBANK_SLOTS = BoatSim::RIVERBANK_MAX_VERTICES;
+	static const size_t RIVERBANK_CLIFF_QUADS = 2 * 2 * RIVERBANK_SLOTS; //(2 banks, 2 quads per slot)
+	static const size_t RIVERBANK_QUADS = RIVERBANK_CLIFF_QUADS + 2 * RIVERBANK_SLOTS;
+	GLuint riverbank_buffer = 0;
+
+	//Vertex Array Object that maps riverbank_buffer to color_texture_program attribute locations:
+	GLuint riverbank_buffer_for_color_texture_program = 0;
+
+	//what riverbank_buffer holds, as of the last syncRiverbankMesh():
+	bool riverbank_mesh_valid = false;
+	uint32_t riverbank_mesh_seed = 0; //course (BoatSim::seed) it was built from
+	int32_t riverbank_mesh_newest_row = 0;
+	size_t riverbank_mesh_head[2] = {0, 0}; //head slot of the left and right bank polylines
+
+	//one slot's vertices, on their way to riverbank_buffer:
+	std::vector< Vertex > riverbank_scratch;
+
+	//alternatively, riverbanks can be drawn by riverbank_program as one full-screen quad
+	// that looks up each pixel's rows in riverbank_edges_tex (cost depends on screen size, not on how twisty the river is):
+	bool draw_riverbanks_with_shader = false;
+
+	//Shader program that draws the riverbanks from riverbank_edges_tex:
+	RiverbankProgram riverbank_program;
+
+	//(left, right) bank x of each kept row, as an RG32F texture with row r at texel r % RIVERBANK_ROWS
+	// (only rows generated since the last syncRiverbankEdges() are uploaded):
+	GLuint riverbank_edges_tex = 0;
+	bool riverbank_edges_valid = false;
+	uint32_t riverbank_edges_seed = 0; //course (BoatSim::seed) it was built from
+	int32_t riverbank_edges_newest_row = 0;
+	glm::vec2 riverbank_edges_scratch[BoatSim::RIVERBANK_ROWS];
+
+	//riverbank_program draws without vertex attributes, but still needs some vertex array object bound:
+	GLuint empty_vertex_array = 0;
+
+	//the scene is drawn at RIVER_WIDTH x RIVER_HEIGHT into scene_tex (through scene_framebuffer),
+	// then copied to the window with a nearest-filtered, whole-number upscale, letterboxed to fit:
+	GLuint scene_tex = 0;
+	GLuint scene_framebuffer = 0;
 
-	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
-	GLuint vertex_buffer_for_color_texture_program = 0;
+	//obstacle sprites (in river coordinates, animated by sprite_program) stay on the GPU,
+	// and a pool slot's sprites are only rewritten when a different obstacle (or none) is in it (see syncObstacleSprites()).
+	//each slot has a fixed place, grouped by drawing order:
+	static const size_t BOX_RIPPLE_SPRITES = 0; //two per box slot: underwater part, ripple
+	static const size_t BOMB_RIPPLE_SPRITES = BOX_RIPPLE_SPRITES + 2 * BoatSim::MAX_BOXES;
+	static const size_t BOX_SPRITES = BOMB_RIPPLE_SPRITES + BoatSim::MAX_BOMBS;
+	static const size_t BOMB_SPRITES = BOX_SPRITES + BoatSim::MAX_BOXES;
+	static const size_t OBSTACLE_SPRITES = BOMB_SPRITES + BoatSim::MAX_BOMBS;
+	GLuint obstacle_buffer = 0;
+
+	//what obstacle_buffer holds for each pool slot, as of the last syncObstacleSprites():
+	struct ObstacleSlot {
+		bool live = false;
+		glm::vec2 position = glm::vec2(0.0f);
+		float bob_offset = 0.0f;
+	};
+	ObstacleSlot box_slots[BoatSim::MAX_BOXES];
+	ObstacleSlot bomb_slots[BoatSim::MAX_BOMBS];
+
+	//text as last laid out by drawText(), one for each piece of text drawn:
+	enum Text : uint32_t { ScoreText, GameText, OverText, FinalScoreText, PressSpaceText, RetryText, TextCount };
+	struct TextMesh {
+		static const size_t MaxLength = 32;
+		char text[MaxLength];
+		size_t length = 0;
+		glm::vec2 pos = glm::vec2(0.0f);
+		float scale = 0.0f;
+		glm::u8vec4 color = glm::u8vec4(0);
+		std::vector< Sprite > sprites; //one per glyph (reserved for MaxLength up front)
+	};
+	TextMesh text_meshes[TextCount];
+
+	//sprites drawn this frame (kept between frames so its storage is reused):
+	std::vector< Sprite > sprites;
+	static const size_t SPRITES_RESERVED = 1024;
+
+	//----- render queue -----
+	//draw() queues everything it draws as commands with 64-bit sort keys, sorts them (radix sort; see sortRenderQueue()),
+	// and draws them in key order, merging neighbouring commands that share a program, texture, and space into one draw.
+	//key, from most to least significant bits: layer (8), program (8), texture (8), depth (24), and 16 unused bits
+	// (commands with equal keys are drawn in the order they were queued):
+
+	//layers, bottom to top (layers from OverlayLayer up are in screen pixels, the rest in river coordinates):
+	enum Layer : uint8_t {
+		BoatUnderwaterLayer, //boat stack below the ripple
+		BoatRippleLayer,
+		ObstacleLayer,
+		RiverbankLayer,
+		BoatLayer, //boat stack above the ripple
+		OverlayLayer, //game over shade
+		TextLayer,
+	};
+	//what draws a command:
+	enum RenderProgram : uint8_t {
+		SpriteStream, //sprite_program, from sprites (uploaded to sprite_buffer in sorted order)
+		ObstacleSprites, //sprite_program, from obstacle_buffer
+		RiverbankMesh, //color_texture_program, from riverbank_buffer (counted in quads)
+		RiverbankShader, //riverbank_program (one full-screen quad)
+	};
+	//which texture a command samples:
+	enum RenderTexture : uint8_t {
+		TilesetTexture,
+		BoatStackTexture,
+	};
+	struct RenderCommand {
+		uint64_t key;
+		uint32_t first; //sprite in 'sprites' (SpriteStream) or first element of the program's buffer
+		uint32_t count;
+	};
+	static uint64_t renderKey(Layer layer, RenderProgram program, RenderTexture texture, uint32_t depth = 0);
+
+	//this frame's commands (and scratch space for sorting them; both reserved up front):
+	std::vector< RenderCommand > render_queue;
+	std::vector< RenderCommand > render_queue_scratch;
+	static const size_t RENDER_COMMANDS_RESERVED = SPRITES_RESERVED + 64;
+
+	//SpriteStream sprites in the order they're drawn:
+	std::vector< Sprite > sorted_sprites;
+
+	//queue sprites [begin, end) of 'sprites', one command each:
+	void queueSprites(Layer layer, RenderTexture texture, size_t begin, size_t end, uint32_t depth = 0);
+	//queue 'count' elements starting at 'first' of a buffer that stays on the GPU:
+	void queueDraw(Layer layer, RenderProgram program, RenderTexture texture, uint32_t depth, size_t first, size_t count);
+	//stable sort of render_queue by key:
+	void sortRenderQueue();
+
+	//Buffer used to hold sprites during drawing (a ring of per-frame regions; see StreamBuffer.hpp):
+	StreamBuffer sprite_buffer{sizeof(Sprite), SPRITES_RESERVED};
+
+	//Vertex Array Object that maps sprite_buffer or obstacle_buffer to sprite_program attribute locations (as per-instance attributes):
+	GLuint sprite_buffer_for_sprite_program = 0;
 
 	//Solid white texture:
 	GLuint white_tex = 0;
 
-	//tileset texture:
+	//tileset texture (dist/boat-atlas-index.png, packed by pack-atlas; its sprites are listed in boat_atlas.hpp).
+	// it holds one palette index per texel (GL_R8), which the shaders look up in palette_tex (dist/boat-atlas-palette.png),
+	// so a recolored sprite only needs a different palette:
 	GLuint tileset_tex = 0;
-	glm::vec2 tilesize = glm::vec2(24.0f, 36.0f);
-	glm::vec2 tileset_size;
-	glm::vec2 tileset_tiles;
+	GLuint palette_tex = 0;
+
+	//texture rectangle of frame 'frame' of an atlas sprite, as a Sprite::TexRect:
+	static glm::vec4 atlasRect(AtlasSprite const &sprite, uint32_t frame = 0);
+	//an atlas sprite's frame grid, as Sprite::Frames:
+	static glm::vec4 atlasFrames(AtlasSprite const &sprite);
+	//texture coordinate of the middle of an atlas sprite's first pixel (for solid colors):
+	static glm::vec2 atlasTexel(AtlasSprite const &sprite);
+
+	//the boat is a stack of BOAT_LAYERS sprites, each rotated about its own center and one pixel above the last.
+	//rather than drawing every layer every frame, the stack is drawn once per quantized rotation
+	// into boat_stack_tex (see bakeBoatStacks()), in two cells per rotation:
+	// layers [0, BOAT_UNDERWATER_LAYER] (drawn under the ripple) and the rest (drawn over everything but the UI):
+	static const int BOAT_LAYERS = 36;
+	static const int BOAT_UNDERWATER_LAYER = 7;
+	static const int BOAT_STACK_ROTATIONS = 128;
+	static const int BOAT_STACK_COLUMNS = 16; //cells per row of boat_stack_tex
+	//size of a cell, and where the center of layer 0 goes in it (room for a 24x36 layer at any rotation, 35 pixels up):
+	const glm::vec2 boat_stack_cell = glm::vec2(48.0f, 84.0f);
+	const glm::vec2 boat_stack_anchor = glm::vec2(24.0f, 60.0f);
+	GLuint boat_stack_tex = 0;
+	glm::vec2 boat_stack_tex_size;
+
 
-	//matrix that maps from clip coordinates to court-space coordinates:
 	glm::mat3x2 clip_to_court = glm::mat3x2(1.0f);
 	// computed in draw() as the inverse of OBJECT_TO_CLIP
 	// (stored here so that the mouse handling code can use it to position the paddle)
 
-	// river generation
-	void generateRiver(int num_samples);
+	// draw the boat stacks into boat_stack_tex (at load time; needs the tileset and sprite_program):
+	void bakeBoatStacks();
+	//TexRect of the boat stack cell nearest 'rotation' (radians); 'upper' picks the layers above the ripple:
+	glm::vec4 boatStackRect(float rotation, bool upper) const;
+
+	//draw 'count' sprites starting at element 'first' of 'buffer', as one instance each
+	// (sprite_program, its uniforms, and its texture must already be set up):
+	void drawSprites(GLuint buffer, size_t first, size_t count);
 
 	// helper draw functions
-	void drawTexture(std::vector< Vertex > &vertices, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, float rotation);
-	void drawText(std::vector< Vertex > &vertices, std::string text, glm::vec2 pos, float scale, glm::u8vec4 color);
-	void drawBoatRipples(std::vector< Vertex > &vertices);
-	void drawBoxRipples(std::vector< Vertex > &vertices);
-	void drawBombRipples(std::vector< Vertex > &vertices);
-	void drawBoat(std::vector< Vertex > &vertices);
-	void drawBoxes(std::vector< Vertex > &vertices);
-	void drawBombs(std::vector< Vertex > &vertices);
+	//textured rectangle, unrotated:
+	void drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color);
+	//...rotated around its center by 'rotation' given as (cos, sin) (compute once for sprites that share a rotation):
+	void drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, glm::vec2 rotation);
+	//...rotated around its center by 'rotation' radians:
+	void drawTexture(std::vector< Sprite > &sprites, glm::vec2 pos, glm::vec2 size, glm::vec2 tilepos, glm::vec2 tilesize, glm::u8vec4 color, float rotation);
+	//quad with horizontal top and bottom edges, spanning x in [top_x.x, top_x.y] at the top and [bottom_x.x, bottom_x.y] at the bottom,
+	// filled with the texel at texcoord:
+	void drawTrapezoid(std::vector< Vertex > &vertices, float top, glm::vec2 top_x, float bottom, glm::vec2 bottom_x, glm::vec2 texcoord, glm::u8vec4 color);
+	//'length' characters of 'text' (upper case letters, digits, '.', and ' '), kept in text_meshes[which]:
+	// (they're only laid out again when the text, position, scale, or color changes)
+	void drawText(std::vector< Sprite > &sprites, Text which, char const *text, size_t length, glm::vec2 pos, float scale, glm::u8vec4 color);
+	void drawBoatRipples(std::vector< Sprite > &sprites);
+	void drawBoat(std::vector< Sprite > &sprites);
+
+	// obstacle sprite upkeep, called after the sim changes:
+	void syncObstacleSprites();
+	//rewrite the sprites for box (or bomb) pool slot 'slot' (zero-area if the slot is empty):
+	void writeBoxSprites(size_t slot, bool live);
+	void writeBombSprites(size_t slot, bool live);
+
+	// riverbank mesh and edge texture upkeep, called after the sim changes:
+	void syncRiverbankMesh();
+	void syncRiverbankEdges();
+	//rewrite the quads for slot 'slot' of bank 'b' (0 = left, 1 = right):
+	void writeRiverbankSlot(size_t b, size_t slot);
 };
@@ -0,0 +1,313 @@
+#include "BoatSim.hpp"
+
+#include <utility>
+
+//first index in [begin, end) of 'obstacles' for which 'pred' is false
+// ('pred' must be true for a prefix of the range and false after):
+template< typename Pool, typename Pred >
+static size_t partition_index(Pool const &obstacles, size_t begin, size_t end, Pred const &pred) {
+	while (begin < end) {
+		size_t mid = begin + (end - begin) / 2;
+		if (pred(obstacles.y[obstacles.slot(mid)])) begin = mid + 1;
+		else end = mid;
+	}
+	return begin;
+}
+
+//'obstacles' is sorted by decreasing y and every element is 'height' tall;
+// returns the [begin, end) indices of elements with rows overlapping the open interval (y_min - height, y_max):
+template< typename Pool >
+static std::pair< size_t, size_t > overlapping_rows(Pool const &obstacles, float height, float y_min, float y_max) {
+	size_t begin = partition_index(obstacles, 0, obstacles.size(), [&](float y) { return y >= y_max; });
+	size_t end = partition_index(obstacles, begin, obstacles.size(), [&](float y) { return y > y_min - height; });
+	return std::make_pair(begin, end);
+}
+
+//(definitions for constants that get passed by reference)
+constexpr float BoatSim::START_Y;
+constexpr float BoatSim::MAX_CAMERA_SPEED;
+constexpr float BoatSim::CAMERA_START_SPEED;
+constexpr float BoatSim::CAMERA_ACCEL_ZONE;
+constexpr float BoatSim::ROTATION_SPEED;
+constexpr float BoatSim::MOVE_SPEED;
+constexpr float BoatSim::ACCEL_SPEED;
+constexpr float BoatSim::FIRST_BOMB_DISTANCE;
+
+const glm::vec2 BoatSim::BOX_SIZE = glm::vec2(24.0f, 24.0f);
+const glm::vec2 BoatSim::BOMB_SIZE = glm::vec2(12.0f, 1.0f);
+
+BoatSim::BoatSim(uint32_t seed_)
+	: boat(glm::vec2(0.5f * RIVER_WIDTH - 12.0f, START_Y), glm::vec2(20.0f, 34.0f), glm::vec2(24.0f, 36.0f), glm::vec2(0.0f, 0.0f), 0.0f),
+	  seed(seed_)
+	{
+
+	generateRiver(RIVERBANK_ROWS);
+}
+
+void BoatSim::update(float elapsed, Input const &input) {
+	camera_speed = CAMERA_START_SPEED + 0.4f * (0.4f * score);
+	if (camera_speed > MAX_CAMERA_SPEED) camera_speed = MAX_CAMERA_SPEED;
+	if (!game_over && camera_started) {
+		if (boat.position.y - camera.y <= CAMERA_ACCEL_ZONE) camera.y += -camera_speed * elapsed + 50.0f * (boat.position.y - camera.y - CAMERA_ACCEL_ZONE) * elapsed * elapsed;
+		else camera.y -= camera_speed * elapsed;
+	}
+
+	//retire obstacles that have scrolled off the bottom of the screen
+	// (the oldest are lowest on screen, so they're the ones that scroll off first):
+	while (!boxes.empty() && boxes.position(0).y - camera.y > RIVER_HEIGHT) {
+		boxes.pop_front();
+	}
+	while (!bombs.empty() && bombs.position(0).y - camera.y > RIVER_HEIGHT) {
+		bombs.pop_front();
+	}
+
+	//keep the river generated RIVERBANK_LOOKAHEAD rows above the camera, a few rows per update
+	// (so no single update pays for a big chunk of river):
+	int rows_behind = (int) glm::ceil(river_head.bank.position_left.y - (camera.y - RIVERBANK_LOOKAHEAD));
+	if (rows_behind > 0) {
+		generateRiver(glm::min(rows_behind, RIVERBANK_ROWS_PER_UPDATE));
+	}
+	riverbank_left.retire_before(riverbank_first_row());
+	riverbank_right.retire_before(riverbank_first_row());
+
+	glm::vec2 acceleration(0.0f, 0.0f);
+
+	if (!game_over) {
+		if (input.left) {
+			boat.rotation += ROTATION_SPEED * elapsed;
+		} if (input.right) {
+			boat.rotation -= ROTATION_SPEED * elapsed;
+		}
+
+		if (input.up) {
+			acceleration = glm::vec2(-glm::sin(boat.rotation) * ACCEL_SPEED, -glm::cos(boat.rotation) * ACCEL_SPEED);
+		} else if (input.down) {
+			acceleration = glm::vec2(glm::sin(boat.rotation) * ACCEL_SPEED, glm::cos(boat.rotation) * ACCEL_SPEED);
+		}
+		else acceleration += -boat.velocity * 100.0f * elapsed;
+
+		boat.velocity += acceleration * elapsed;
+		if (glm::length(boat.velocity) > MOVE_SPEED) {
+			boat.velocity = MOVE_SPEED * (boat.velocity / glm::length(boat.velocity));
+		}
+
+		//does the obstacle in slot 's' of 'pool' overlap the boat?
+		auto collision = [](auto const &pool, size_t s, Boat const &b2) -> bool {
+			if (pool.x[s] >= b2.position.x + b2.size.x ||
+				pool.x[s] <= b2.position.x - pool.width[s] ||
+				pool.y[s] >= b2.position.y + b2.size.y ||
+				pool.y[s] <= b2.position.y - pool.height[s]) return false;
+			return true;
+		};
+
+		//only obstacles in the rows the boat spans can collide with it.
+		// (boxes are spawned far enough apart that pushing the boat out of one can't move it into another)
+		auto near_boxes = [&]() { return overlapping_rows(boxes, BOX_SIZE.y, boat.position.y, boat.position.y + boat.size.y); };
+		auto near_bombs = [&]() { return overlapping_rows(bombs, BOMB_SIZE.y, boat.position.y, boat.position.y + boat.size.y); };
+
+		boat.position.x += boat.velocity.x * elapsed + acceleration.x * elapsed * elapsed * 0.5f;
+		auto boxes_x = near_boxes();
+		for (size_t b = boxes_x.first; b < boxes_x.second; ++b) {
+			size_t s = boxes.slot(b);
+			if (collision(boxes, s, boat)) {
+				if (boat.velocity.x > 0) {
+					boat.position.x = boxes.x[s] - boat.size.x;
+				}
+				else {
+					boat.position.x = boxes.x[s] + boxes.width[s];
+				}
+				boat.velocity.x = 0;
+			}
+		}
+		auto bombs_x = near_bombs();
+		for (size_t b = bombs_x.first; b < bombs_x.second; ++b) {
+			if (collision(bombs, bombs.slot(b), boat)) {
+				game_over = true;
+			}
+		}
+		if (boat.position.x + boat.size.x >= RIVER_WIDTH) boat.position.x = RIVER_WIDTH - boat.size.x;
+		if (boat.position.x <= 0) boat.position.x = 0;
+
+		boat.position.y += boat.velocity.y * elapsed + acceleration.y * elapsed * elapsed * 0.5f;
+		auto boxes_y = near_boxes();
+		for (size_t b = boxes_y.first; b < boxes_y.second; ++b) {
+			size_t s = boxes.slot(b);
+			if (collision(boxes, s, boat)) {
+				if (boat.velocity.y > 0) {
+					boat.position.y = boxes.y[s] - boat.size.y;
+				}
+				else {
+					boat.position.y = boxes.y[s] + boxes.height[s];
+				}
+				boat.velocity.y = 0;
+			}
+		}
+		auto bombs_y = near_bombs();
+		for (size_t b = bombs_y.first; b < bombs_y.second; ++b) {
+			if (collision(bombs, bombs.slot(b), boat)) {
+				game_over = true;
+			}
+		}
+		if (!camera_started && boat.position.y <= RIVER_HEIGHT * 0.5f) camera_started = true;
+		if (boat.position.y - camera.y >= RIVER_HEIGHT + 96.0f) {
+			game_over = true;
+		}
+		if (boat.position.y - camera.y <= 0) boat.position.y = camera.y;
+
+		score = glm::max(score, (START_Y - boat.position.y) / 24.0f);
+
+		//only the rows under the boat can touch it, and along each bank segment
+		// the bank is furthest in at one of the segment's ends:
+		int y_min = (int) glm::ceil(boat.position.y);
+		int y_max = (int) glm::ceil(boat.position.y + boat.size.y) - 1;
+		int32_t first = glm::max(RIVER_HEIGHT - y_max, riverbank_first_row());
+		int32_t last = RIVER_HEIGHT - y_min;
+		float min_x, max_x;
+		if (riverbank_left.x_range(first, last, &min_x, &max_x) && boat.position.x < max_x) {
+			game_over = true;
+		}
+		if (riverbank_right.x_range(first, last, &min_x, &max_x) && boat.position.x + boat.size.x > min_x) {
+			game_over = true;
+		}
+	}
+	else {
+		if (input.space) {
+			reset_level();
+		}
+	}
+}
+
+void BoatSim::reset_level() {
+	score = 0.0f;
+
+	boat.rotation = 0.0f;
+	boat.position = glm::vec2(0.5f * RIVER_WIDTH - 12.0f, START_Y);
+	boat.velocity = glm::vec2(0.0f, 0.0f);
+
+	camera = glm::vec2(0.0f, 0.0f);
+	camera_started = false;
+	camera_speed = CAMERA_START_SPEED;
+
+	boxes.clear();
+	bombs.clear();
+
+	//each retry gets a new course; deriving its seed from the last one keeps replays reproducible:
+	// (row -1 is never generated, so this draw is never used for anything else)
+	seed = river_random(seed, -1, 0);
+
+	riverbank_left.clear();
+	riverbank_right.clear();
+	generateRiver(RIVERBANK_ROWS);
+
+	game_over = false;
+}
+
+bool BoatSim::riverbank_x(int y, float *left, float *right) const {
+	int32_t row = RIVER_HEIGHT - y;
+	if (row < riverbank_first_row()) return false;
+	return riverbank_left.x_at_row(row, left) && riverbank_right.x_at_row(row, right);
+}
+
+static inline uint32_t pcg_hash(uint32_t input) {
+	//one round of PCG-RXS-M-XS (see "Hash Functions for GPU Rendering", Jarzynski & Olano):
+	uint32_t state = input * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+uint32_t BoatSim::river_random(uint32_t seed, int32_t row, uint32_t draw) {
+	return pcg_hash(pcg_hash(pcg_hash(seed) + uint32_t(row)) + draw);
+}
+
+float BoatSim::normal_river_width(int32_t index) {
+	//distance (in score meters) the boat has come when it reaches this row:
+	float distance = (START_Y - (RIVER_HEIGHT - index)) / 24.0f;
+	return glm::max(START_NORMAL_RIVER_WIDTH - 1.5f * (0.4f * distance), float(MIN_NORMAL_RIVER_WIDTH));
+}
+
+BoatSim::RiverRow BoatSim::first_river_row() {
+	RiverRow row;
+	row.index = 0;
+	row.bank.position_left = glm::vec2(0, RIVER_HEIGHT);
+	row.bank.momentum_left = 1;
+	row.bank.position_right = glm::vec2(RIVER_WIDTH - 1, RIVER_HEIGHT);
+	row.bank.momentum_right = -1;
+	row.rows_since_obstacle = 1000;
+	return row;
+}
+
+BoatSim::RiverRow BoatSim::next_river_row(uint32_t seed, RiverRow const &prev, RiverSpawn *spawn) {
+	//each random choice on a row gets its own draw index:
+	enum : uint32_t { DrawTurn, DrawTurnWhich, DrawSpawn, DrawBomb, DrawX, DrawBob };
+
+	RiverRow row = prev;
+	row.index++;
+	row.rows_since_obstacle++;
+	*spawn = RiverSpawn();
+
+	RiverbankPoint &current = row.bank;
+	current.position_left.x += current.momentum_left;
+	current.position_left.y--;
+	current.position_right.x += current.momentum_right;
+	current.position_right.y--;
+
+	if (current.position_left.x < 0) {
+		current.position_left.x = 0;
+		current.momentum_left *= -1;
+	}
+	if (current.position_right.x >= RIVER_WIDTH) {
+		current.position_right.x = (float) RIVER_WIDTH - 1.0f;
+		current.momentum_right *= -1;
+	}
+
+	float gap = current.position_right.x - current.position_left.x;
+
+	if (gap <= MIN_RIVER_WIDTH) {
+		if (current.momentum_left > 0 && current.momentum_right < 0) {
+			if (glm::abs(current.momentum_left) > glm::abs(current.momentum_right)) current.momentum_left *= -1;
+			else current.momentum_right *= -1;
+		} else if (current.momentum_left > 0) current.momentum_left *= -1;
+		else if (current.momentum_right < 0) current.momentum_right *= 1;
+	} else if (gap <= normal_river_width(row.index)) {
+		if (river_random(seed, row.index, DrawTurn) % 100 >= 95) {
+			if (current.momentum_left > 0 && current.momentum_right < 0) {
+				if (river_random(seed, row.index, DrawTurnWhich) % 2 == 0) current.momentum_left *= -1;
+				else current.momentum_right *= -1;
+			} else if (current.momentum_left > 0) current.momentum_left *= -1;
+			else if (current.momentum_right < 0) current.momentum_right *= -1;
+		}
+
+		if (river_random(seed, row.index, DrawSpawn) % 10 >= 2 && row.rows_since_obstacle > MIN_ROWS_BETWEEN_OBSTACLES && row.index >= FIRST_OBSTACLE_ROW) {
+			float distance = (START_Y - current.position_left.y) / 24.0f;
+			int minx = (int) current.position_left.x + 12;
+			int maxx = (int) current.position_right.x - 24 - 12;
+			int x = (river_random(seed, row.index, DrawX) % (maxx - minx)) + minx;
+			spawn->type = (distance >= FIRST_BOMB_DISTANCE && river_random(seed, row.index, DrawBomb) % 5 == 1 ? RiverSpawn::Bomb : RiverSpawn::Box);
+			spawn->position = glm::vec2(x, current.position_left.y);
+			spawn->bob_offset = 0.1f * (river_random(seed, row.index, DrawBob) % 10);
+			row.rows_since_obstacle = 0;
+		}
+	}
+
+	return row;
+}
+
+void BoatSim::generateRiver(int num_samples) {
+	for (int i = 0; i < num_samples; i++) {
+		RiverSpawn spawn;
+		if (riverbank_left.empty()) {
+			river_head = first_river_row();
+		} else {
+			river_head = next_river_row(seed, river_head, &spawn);
+		}
+
+		if (spawn.type == RiverSpawn::Box) {
+			boxes.push_back(spawn.position, BOX_SIZE, spawn.bob_offset);
+		} else if (spawn.type == RiverSpawn::Bomb) {
+			bombs.push_back(spawn.position, BOMB_SIZE, spawn.bob_offset);
+		}
+
+		riverbank_left.push_row(river_head.index, river_head.bank.position_left.x);
+		riverbank_right.push_row(river_head.index, river_head.bank.position_right.x);
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "ObstaclePool.hpp"
+#include "RiverbankPolyline.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+/*
+ * BoatSim is the game state of the boating game, along with the rules that advance it.
+ * It does no drawing and reads no devices, so it can be stepped without a window
+ *  (BoatMode wraps it with keyboard input, music, and rendering).
+ */
+
+struct BoatSim {
+	BoatSim(uint32_t seed);
+
+	//A BoatSim is one trivially copyable block (no pointers, no heap, no global generator state),
+	// so snapshotting or rolling back a game is plain assignment, e.g.:
+	//   BoatSim saved = sim; ...; sim = saved;
+
+	//buttons held down during a step:
+	struct Input {
+		bool left = false;
+		bool right = false;
+		bool up = false;
+		bool down = false;
+		bool space = false;
+	};
+
+	//advance the game by 'elapsed' seconds with 'input' held:
+	void update(float elapsed, Input const &input);
+
+	//start over (after a game over) on a new course, whose seed is derived from the last one:
+	void reset_level();
+
+	//----- constants -----
+	static const int RIVER_WIDTH = 312;
+	static const int RIVER_HEIGHT = 480;
+
+	static constexpr float START_Y = RIVER_HEIGHT - 72.0f;
+
+	static constexpr float MAX_CAMERA_SPEED = 150.0f;
+	static constexpr float CAMERA_START_SPEED = 60.0f;
+	static constexpr float CAMERA_ACCEL_ZONE = RIVER_HEIGHT * 0.5f;
+
+	static constexpr float ROTATION_SPEED = 5.0f;
+	static constexpr float MOVE_SPEED = 180.0f;
+	static constexpr float ACCEL_SPEED = 400.0f;
+
+	//----- game state -----
+
+	struct Boat {
+		Boat(glm::vec2 const &position_, glm::vec2 const &size_, glm::vec2 const &draw_size_, glm::vec2 const &velocity_, float const &rotation_) :
+			position(position_), size(size_), drawsize(draw_size_), velocity(velocity_), rotation(rotation_) { }
+		glm::vec2 position;
+		glm::vec2 size;
+		glm::vec2 drawsize;
+		glm::vec2 velocity;
+		float rotation;
+	};
+
+	struct RiverbankPoint {
+		glm::vec2 position_left;
+		float momentum_left;
+		glm::vec2 position_right;
+		float momentum_right;
+	};
+
+	static const glm::vec2 BOX_SIZE;
+	static const glm::vec2 BOMB_SIZE;
+
+	//at most this many of each obstacle are alive at once (spawns are skipped if a pool is full);
+	// obstacles are at least 144 rows apart and live for under 1500 rows, so this isn't hit in practice:
+	static const int MAX_BOXES = 32;
+	static const int MAX_BOMBS = 32;
+
+	Boat boat;
+	//boxes (solid; push the boat) and bombs (end the game on contact), each with a position, size, and bob_offset.
+	//obstacles are spawned in order of decreasing y, so both pools stay sorted that way
+	// (collision binary-searches them for the rows near the boat):
+	ObstaclePool< MAX_BOXES > boxes;
+	ObstaclePool< MAX_BOMBS > bombs;
+	float score = 0.0f;
+	bool game_over = false;
+
+	static const int MIN_NORMAL_RIVER_WIDTH = 156;
+	static const int START_NORMAL_RIVER_WIDTH = RIVER_WIDTH;
+	static const int MIN_RIVER_WIDTH = 108;
+	//rows of river kept, from the look-ahead down to a little below the bottom of the screen:
+	static const int RIVERBANK_ROWS = RIVER_HEIGHT * 2;
+	//river is generated this many rows above the top of the screen:
+	static const int RIVERBANK_LOOKAHEAD = RIVERBANK_ROWS - RIVER_HEIGHT - 64;
+	//at most this many rows are generated per update. this must stay above the most the camera can move in one update:
+	// MAX_CAMERA_SPEED * Tick (1.25 rows) plus the catch-up term 50 * (boat.y - camera.y - CAMERA_ACCEL_ZONE) * Tick^2,
+	// which is up to ~0.83 rows with the boat held at the top of the screen -- so ~2.1 rows per update in all:
+	static const int RIVERBANK_ROWS_PER_UPDATE = 4;
+	//banks change direction every ~17 rows on average (and at most 65 times in any 1100 rows
+	// over 2000 test seeds), so this is plenty of vertices per bank for RIVERBANK_ROWS:
+	static const int RIVERBANK_MAX_VERTICES = 128;
+	//each bank as a polyline over row index (see RiverbankPolyline.hpp and river course, below):
+	RiverbankPolyline< RIVERBANK_MAX_VERTICES > riverbank_left;
+	RiverbankPolyline< RIVERBANK_MAX_VERTICES > riverbank_right;
+
+	//oldest row still kept (older rows may linger in the polylines, but are treated as gone):
+	int32_t riverbank_first_row() const { return river_head.index - RIVERBANK_ROWS + 1; }
+	//x of the left and right banks on the row at height 'y'; returns false if that row isn't kept:
+	bool riverbank_x(int y, float *left, float *right) const;
+
+	glm::vec2 camera = glm::vec2(0.0f, 0.0f);
+	float camera_speed = CAMERA_START_SPEED;
+	bool camera_started = false;
+
+	//----- river course -----
+	//Row n is built from row n - 1 and random draws keyed by (seed, n, draw) -- no generator
+	// stream and no other game state -- so the same seed always gives the same river.
+	//The draws are random-access, but the bank position, its momentum, and rows_since_obstacle
+	// carry from row to row, so rows can only be rebuilt in order, starting from a saved RiverRow
+	// (river_head, or a copy of it); there is no way to jump straight to row n.
+	//To seek (e.g., in a replay), copy the whole BoatSim instead.
+
+	//row 0 is the bottom row of the starting screen; row n is at y = RIVER_HEIGHT - n:
+	struct RiverRow {
+		int32_t index;
+		RiverbankPoint bank;
+		int32_t rows_since_obstacle;
+	};
+
+	//obstacle (if any) spawned on a row:
+	struct RiverSpawn {
+		enum Type : uint8_t { None, Box, Bomb } type = None;
+		glm::vec2 position = glm::vec2(0.0f);
+		float bob_offset = 0.0f;
+	};
+
+	//obstacles are at least this many rows apart:
+	static const int MIN_ROWS_BETWEEN_OBSTACLES = 144;
+	//no obstacles on the starting screen (or just above it, where they'd pop in):
+	static const int FIRST_OBSTACLE_ROW = RIVER_HEIGHT + 48;
+	//bombs start showing up this far (in score meters) down the river:
+	static constexpr float FIRST_BOMB_DISTANCE = 150.0f;
+
+	static RiverRow first_river_row();
+	static RiverRow next_river_row(uint32_t seed, RiverRow const &prev, RiverSpawn *spawn);
+	//how wide the river tends to be at a row (it narrows with distance):
+	static float normal_river_width(int32_t index);
+	//random number for draw 'draw' of row 'row':
+	static uint32_t river_random(uint32_t seed, int32_t row, uint32_t draw);
+
+	//seed of the current course (the constructor's seed, then a new one on each reset_level()):
+	uint32_t seed = 0;
+	RiverRow river_head; //newest generated row (its bank is the newest row of riverbank_left/right)
+
+	// river generation (appends 'num_samples' rows above the newest one)
+	void generateRiver(int num_samples);
+};
+
+static_assert(std::is_trivially_copyable< BoatSim >::value, "BoatSim should be snapshot-able by plain copy");
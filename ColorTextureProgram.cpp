@@ -24,11 +24,15 @@ ColorTextureProgram::ColorTextureProgram() {
 		//fragment shader:
 		"#version 330\n"
 		"uniform sampler2D TEX;\n"
+		"uniform bool INDEXED;\n"
+		"uniform sampler2D PALETTE;\n"
 		"in vec4 color;\n"
 		"in vec2 texCoord;\n"
 		"out vec4 fragColor;\n"
 		"void main() {\n"
-		"	fragColor = texture(TEX, texCoord) * color;\n"
+		"	vec4 texel = texture(TEX, texCoord);\n"
+		"	if (INDEXED) texel = texelFetch(PALETTE, ivec2(int(texel.r * 255.0 + 0.5), 0), 0);\n"
+		"	fragColor = texel * color;\n"
 		"}\n"
 	);
 	//As you can see above, adjacent strings in C/C++ are concatenated.
@@ -42,12 +46,15 @@ ColorTextureProgram::ColorTextureProgram() {
 	//look up the locations of uniforms:
 	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
 	CLIP_OFFSET_vec4 = glGetUniformLocation(program, "CLIP_OFFSET");
+	INDEXED_bool = glGetUniformLocation(program, "INDEXED");
 	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	GLuint PALETTE_sampler2D = glGetUniformLocation(program, "PALETTE");
 
-	//set TEX to always refer to texture binding zero:
+	//set TEX and PALETTE to always refer to texture bindings zero and two:
 	glUseProgram(program); //bind program -- glUniform* calls refer to this program now
 
 	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
+	glUniform1i(PALETTE_sampler2D, 2); //set PALETTE to sample from GL_TEXTURE2
 
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
 }
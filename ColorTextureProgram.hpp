@@ -17,7 +17,9 @@ struct ColorTextureProgram {
 	//Uniform (per-invocation variable) locations:
 	GLuint OBJECT_TO_CLIP_mat4 = -1U;
 	GLuint CLIP_OFFSET_vec4 = -1U;
+	GLuint INDEXED_bool = -1U; //TEX holds palette indices (false by default)
 
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
+	//TEXTURE2 - palette, with color i at texel (i, 0) (only read if INDEXED)
 };
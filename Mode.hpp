@@ -13,13 +13,21 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//The function should return 'true' if it handled the event.
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) { return false; }
 
-	//update is called at the start of a new frame, after events are handled:
-	// 'elapsed' is time in seconds since the last call to 'update'
+	//update is called zero or more times per frame, after events are handled:
+	// 'elapsed' is always Mode::Tick, so simulation doesn't depend on frame rate
 	virtual void update(float elapsed) { }
 
-	//draw is called after update:
+	//interpolate is called after the frame's updates and before draw:
+	// 'alpha' in [0,1) is how much of a tick has passed since the last update
+	// (blend the previous and current tick's state by alpha when drawing for smooth motion)
+	virtual void interpolate(float alpha) { }
+
+	//draw is called after interpolate:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//fixed simulation time step, in seconds:
+	static const float Tick;
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
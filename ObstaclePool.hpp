@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cassert>
+
+/*
+ * ObstaclePool is fixed-capacity storage for obstacles that spawn at one end of the river
+ *  and scroll off the other: obstacles are added at the back and retired from the front,
+ *  and retired slots are reused by later spawns. Nothing is allocated after construction.
+ *
+ * Obstacle i is the i'th oldest, so spawn order is preserved.
+ * Storage is structure-of-arrays indexed by *slot* (see slot()), so that per-obstacle
+ *  work (e.g. collision, or keeping BoatMode's per-slot obstacle sprites up to date) can work on whole arrays or single slots.
+ */
+
+template< size_t Capacity >
+struct ObstaclePool {
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	bool full() const { return count == Capacity; }
+	static size_t capacity() { return Capacity; }
+
+	//slot that holds the i'th oldest obstacle:
+	size_t slot(size_t i) const { assert(i < count); return (head + i) % Capacity; }
+
+	glm::vec2 position(size_t i) const { size_t s = slot(i); return glm::vec2(x[s], y[s]); }
+	glm::vec2 extent(size_t i) const { size_t s = slot(i); return glm::vec2(width[s], height[s]); }
+
+	//returns false (and stores nothing) if every slot is in use:
+	bool push_back(glm::vec2 const &position_, glm::vec2 const &size_, float bob_offset_) {
+		if (full()) return false;
+		size_t s = (head + count) % Capacity;
+		x[s] = position_.x;
+		y[s] = position_.y;
+		width[s] = size_.x;
+		height[s] = size_.y;
+		bob_offset[s] = bob_offset_;
+		++count;
+		return true;
+	}
+
+	void pop_front() {
+		assert(count > 0);
+		head = (head + 1) % Capacity;
+		--count;
+	}
+
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	//----- storage (indexed by slot) -----
+	alignas(16) float x[Capacity] = {};
+	alignas(16) float y[Capacity] = {};
+	alignas(16) float width[Capacity] = {};
+	alignas(16) float height[Capacity] = {};
+	alignas(16) float bob_offset[Capacity] = {};
+
+	size_t head = 0; //slot of the oldest obstacle
+	size_t count = 0;
+};
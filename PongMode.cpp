@@ -2,6 +2,7 @@
 
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
+#include "quad_indices.hpp"
 
 //for glm::value_ptr() :
 #include <glm/gtc/type_ptr.hpp>
@@ -69,6 +70,9 @@ PongMode::PongMode() {
 		//done referring to vertex_buffer, so unbind it:
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+		//quads' triangles come from the shared index buffer (this binding is part of the vertex array object):
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer());
+
 		//done setting up vertex array object, so unbind it:
 		glBindVertexArray(0);
 
@@ -280,13 +284,10 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 
 	//inline helper function for rectangle drawing:
 	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
-		//draw rectangle as two CCW-oriented triangles:
+		//draw rectangle as a CCW-oriented quad (see quad_indices.hpp):
 		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
 		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
 		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
 		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
 	};
 
@@ -422,7 +423,7 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	glBindTexture(GL_TEXTURE_2D, white_tex);
 
 	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	draw_quads(0, vertices.size() / 4);
 
 	//unbind the solid white texture:
 	glBindTexture(GL_TEXTURE_2D, 0);
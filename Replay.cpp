@@ -0,0 +1,94 @@
+#include "Replay.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+//file layout (all integers little-endian):
+//  "brpl" magic, u32 version, u32 seed, u32 tick_rate, u32 tick count,
+//  then (u8 packed input, u16 repeat count) runs covering every tick
+static const char Magic[4] = {'b', 'r', 'p', 'l'};
+static const uint32_t Version = 5; //2: BoatSim uses its own PCG32 instead of rand(); 3: river generated a few rows per update; 4: river keyed by (seed, row); 5: new course seed on each retry
+
+uint8_t Replay::pack(BoatSim::Input const &input) {
+	return (input.left ? 0x01 : 0)
+	     | (input.right ? 0x02 : 0)
+	     | (input.up ? 0x04 : 0)
+	     | (input.down ? 0x08 : 0)
+	     | (input.space ? 0x10 : 0);
+}
+
+BoatSim::Input Replay::unpack(uint8_t bits) {
+	BoatSim::Input input;
+	input.left = (bits & 0x01) != 0;
+	input.right = (bits & 0x02) != 0;
+	input.up = (bits & 0x04) != 0;
+	input.down = (bits & 0x08) != 0;
+	input.space = (bits & 0x10) != 0;
+	return input;
+}
+
+static void write_u32(std::ostream &to, uint32_t value) {
+	char bytes[4] = { char(value & 0xff), char((value >> 8) & 0xff), char((value >> 16) & 0xff), char((value >> 24) & 0xff) };
+	to.write(bytes, 4);
+}
+
+static bool read_u32(std::istream &from, uint32_t *value) {
+	unsigned char bytes[4];
+	if (!from.read(reinterpret_cast< char * >(bytes), 4)) return false;
+	*value = uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+	return true;
+}
+
+void load_replay(std::string filename, Replay *replay) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open replay file '" + filename + "'.");
+	}
+
+	char magic[4];
+	uint32_t version = 0;
+	uint32_t ticks = 0;
+	if (!file.read(magic, 4) || !std::equal(magic, magic + 4, Magic)
+	 || !read_u32(file, &version) || version != Version) {
+		throw std::runtime_error("File '" + filename + "' is not a version " + std::to_string(Version) + " replay.");
+	}
+	if (!read_u32(file, &replay->seed) || !read_u32(file, &replay->tick_rate) || !read_u32(file, &ticks)) {
+		throw std::runtime_error("Failed to read replay header from '" + filename + "'.");
+	}
+
+	replay->inputs.clear();
+	replay->inputs.reserve(ticks);
+	while (replay->inputs.size() < ticks) {
+		unsigned char run[3];
+		if (!file.read(reinterpret_cast< char * >(run), 3)) {
+			throw std::runtime_error("Replay '" + filename + "' ends early.");
+		}
+		uint32_t count = uint32_t(run[1]) | (uint32_t(run[2]) << 8);
+		if (count == 0 || replay->inputs.size() + count > ticks) {
+			throw std::runtime_error("Replay '" + filename + "' has a malformed input run.");
+		}
+		replay->inputs.insert(replay->inputs.end(), count, run[0]);
+	}
+}
+
+void save_replay(std::string filename, Replay const &replay) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	file.write(Magic, 4);
+	write_u32(file, Version);
+	write_u32(file, replay.seed);
+	write_u32(file, replay.tick_rate);
+	write_u32(file, uint32_t(replay.inputs.size()));
+
+	for (size_t begin = 0; begin < replay.inputs.size(); ) {
+		size_t end = begin + 1;
+		while (end < replay.inputs.size() && end - begin < 0xffff && replay.inputs[end] == replay.inputs[begin]) ++end;
+		char run[3] = { char(replay.inputs[begin]), char((end - begin) & 0xff), char(((end - begin) >> 8) & 0xff) };
+		file.write(run, 3);
+		begin = end;
+	}
+
+	if (!file) {
+		throw std::runtime_error("Failed to write replay file '" + filename + "'.");
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "BoatSim.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/*
+ * A Replay is everything needed to reproduce a run of BoatSim exactly:
+ *  the seed it was constructed with and the input held during each fixed tick.
+ */
+
+struct Replay {
+	uint32_t seed = 0;
+	uint32_t tick_rate = 120; //updates per second the inputs were recorded at
+	std::vector< uint8_t > inputs; //one packed BoatSim::Input per tick
+
+	void record(BoatSim::Input const &input) { inputs.emplace_back(pack(input)); }
+	BoatSim::Input input(size_t tick) const { return unpack(inputs[tick]); }
+
+	static uint8_t pack(BoatSim::Input const &input);
+	static BoatSim::Input unpack(uint8_t bits);
+};
+
+//Replay files store the seed and tick rate followed by run-length-encoded inputs
+// (held keys change rarely, so a typical minute of play is a few hundred bytes).
+//NOTE: load_replay will throw on error
+void load_replay(std::string filename, Replay *replay);
+void save_replay(std::string filename, Replay const &replay);
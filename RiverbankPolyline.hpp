@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+/*
+ * RiverbankPolyline stores one bank of the river as a polyline over row indices:
+ *  the bank moves a whole pixel per row and only changes direction now and then,
+ *  so it's stored as the rows where its slope changes rather than as one x per row.
+ *
+ * Vertex i covers rows [row[i], row[i+1]) (the newest vertex covers up to last_row),
+ *  and the bank's x at row r in that span is x[i] + dx[i] * (r - row[i]).
+ *
+ * Like ObstaclePool, vertices are a fixed-capacity ring: new rows are added at the top
+ *  and old vertices retired from the bottom, and nothing is allocated after construction.
+ */
+
+template< size_t Capacity >
+struct RiverbankPolyline {
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	static size_t capacity() { return Capacity; }
+
+	//slot that holds the i'th oldest vertex:
+	size_t slot(size_t i) const { assert(i < count); return (head + i) % Capacity; }
+
+	//rows covered by vertex i, [first, last]:
+	int32_t first_row(size_t i) const { return row[slot(i)]; }
+	int32_t last_row(size_t i) const { return i + 1 < count ? row[slot(i + 1)] - 1 : newest_row; }
+	//x at (possibly fractional) row 'r' along vertex i's segment:
+	float x_at(size_t i, float r) const { size_t s = slot(i); return x[s] + dx[s] * (r - row[s]); }
+
+	//oldest and newest rows stored:
+	int32_t oldest_row() const { assert(count > 0); return row[head]; }
+	int32_t newest() const { assert(count > 0); return newest_row; }
+
+	//append row 'r' (which must be newest() + 1, unless empty) with the bank at 'x_':
+	// (if every vertex is in use the oldest is retired to make room, losing the rows it covered)
+	void push_row(int32_t r, float x_) {
+		if (count != 0) {
+			assert(r == newest_row + 1);
+			size_t s = slot(count - 1);
+			//still on the newest segment?
+			if (x[s] + dx[s] * (r - row[s]) == x_) {
+				newest_row = r;
+				return;
+			}
+			//a vertex that covers only its own row can take on any slope:
+			if (row[s] == newest_row) {
+				dx[s] = x_ - x[s];
+				newest_row = r;
+				return;
+			}
+		}
+		if (count == Capacity) pop_front();
+		size_t s = (head + count) % Capacity;
+		row[s] = r;
+		x[s] = x_;
+		dx[s] = 0.0f;
+		++count;
+		newest_row = r;
+	}
+
+	//index of the vertex covering row 'r', or -1 if 'r' isn't stored:
+	int find(int32_t r) const {
+		if (count == 0 || r < row[head] || r > newest_row) return -1;
+		//last vertex with first_row <= r:
+		size_t begin = 0, end = count;
+		while (end - begin > 1) {
+			size_t mid = begin + (end - begin) / 2;
+			if (row[slot(mid)] <= r) begin = mid;
+			else end = mid;
+		}
+		return int(begin);
+	}
+
+	//bank x at row 'r'; returns false if 'r' isn't stored:
+	bool x_at_row(int32_t r, float *x_) const {
+		int i = find(r);
+		if (i < 0) return false;
+		*x_ = x_at(size_t(i), float(r));
+		return true;
+	}
+
+	//smallest and largest bank x over the stored rows in [r0, r1]; returns false if none are stored:
+	// (x is linear along each segment, so only segment ends need checking)
+	bool x_range(int32_t r0, int32_t r1, float *min_x, float *max_x) const {
+		if (count == 0) return false;
+		r0 = glm::max(r0, row[head]);
+		r1 = glm::min(r1, newest_row);
+		if (r0 > r1) return false;
+		float lo = x_at(size_t(find(r0)), float(r0));
+		float hi = lo;
+		for (size_t i = size_t(find(r0)); i < count && first_row(i) <= r1; ++i) {
+			float a = x_at(i, float(glm::max(first_row(i), r0)));
+			float b = x_at(i, float(glm::min(last_row(i), r1)));
+			lo = glm::min(lo, glm::min(a, b));
+			hi = glm::max(hi, glm::max(a, b));
+		}
+		*min_x = lo;
+		*max_x = hi;
+		return true;
+	}
+
+	//drop vertices that only cover rows before 'r':
+	void retire_before(int32_t r) {
+		while (count > 1 && row[slot(1)] <= r) pop_front();
+	}
+
+	void pop_front() {
+		assert(count > 0);
+		head = (head + 1) % Capacity;
+		--count;
+	}
+
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	//----- storage (indexed by slot) -----
+	int32_t row[Capacity] = {};
+	float x[Capacity] = {};
+	float dx[Capacity] = {};
+
+	size_t head = 0; //slot of the oldest vertex
+	size_t count = 0;
+	int32_t newest_row = 0;
+};
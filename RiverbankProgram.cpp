@@ -0,0 +1,80 @@
+#include "RiverbankProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+RiverbankProgram::RiverbankProgram() {
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"void main() {\n"
+		"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+		"	gl_Position = vec4(2.0 * corner - 1.0, 0.0, 1.0);\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"uniform sampler2D TEX;\n"
+		"uniform sampler2D BANKS;\n"
+		"uniform sampler2D PALETTE;\n"
+		"uniform vec4 FRAG_TO_RIVER;\n"
+		"uniform int ROWS;\n"
+		"uniform int NEWEST_ROW;\n"
+		"uniform int CLIFF_HEIGHT;\n"
+		"uniform vec2 CLIFF_TEXCOORD;\n"
+		"uniform vec2 TOP_TEXCOORD;\n"
+		"out vec4 fragColor;\n"
+		//color of tileset texel 'at' (the tileset holds palette indices):
+		"vec4 tileset(vec2 at) {\n"
+		"	return texelFetch(PALETTE, ivec2(int(texture(TEX, at).r * 255.0 + 0.5), 0), 0);\n"
+		"}\n"
+		//is river x 'x' on the bank at row 'row'?
+		"bool on_bank(int row, float x) {\n"
+		"	if (row < 0 || row > NEWEST_ROW || row <= NEWEST_ROW - ROWS) return false;\n"
+		"	vec2 edges = texelFetch(BANKS, ivec2(row % ROWS, 0), 0).xy;\n"
+		"	return x < edges.x || x >= edges.y;\n"
+		"}\n"
+		"void main() {\n"
+		"	vec2 river = gl_FragCoord.xy * FRAG_TO_RIVER.xy + FRAG_TO_RIVER.zw;\n"
+		//row r covers river y in [y - 1, y) for y = RIVER_HEIGHT - r, so (with RIVER_HEIGHT folded into 'base')
+		// this pixel is the top of row 'base' or on the cliffs of rows 'base' through 'base + CLIFF_HEIGHT':
+		"	int base = -int(floor(river.y)) - (CLIFF_HEIGHT + 1);\n"
+		"	if (on_bank(base, river.x)) {\n"
+		"		fragColor = tileset(TOP_TEXCOORD);\n"
+		"		return;\n"
+		"	}\n"
+		"	for (int i = 1; i <= CLIFF_HEIGHT; ++i) {\n"
+		"		if (on_bank(base + i, river.x)) {\n"
+		"			fragColor = tileset(CLIFF_TEXCOORD);\n"
+		"			return;\n"
+		"		}\n"
+		"	}\n"
+		"	discard;\n"
+		"}\n"
+	);
+
+	//look up the locations of uniforms:
+	FRAG_TO_RIVER_vec4 = glGetUniformLocation(program, "FRAG_TO_RIVER");
+	ROWS_int = glGetUniformLocation(program, "ROWS");
+	NEWEST_ROW_int = glGetUniformLocation(program, "NEWEST_ROW");
+	CLIFF_HEIGHT_int = glGetUniformLocation(program, "CLIFF_HEIGHT");
+	CLIFF_TEXCOORD_vec2 = glGetUniformLocation(program, "CLIFF_TEXCOORD");
+	TOP_TEXCOORD_vec2 = glGetUniformLocation(program, "TOP_TEXCOORD");
+	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	GLuint BANKS_sampler2D = glGetUniformLocation(program, "BANKS");
+	GLuint PALETTE_sampler2D = glGetUniformLocation(program, "PALETTE");
+
+	//set TEX, BANKS, and PALETTE to always refer to texture bindings zero, one, and two:
+	glUseProgram(program);
+
+	glUniform1i(TEX_sampler2D, 0);
+	glUniform1i(BANKS_sampler2D, 1);
+	glUniform1i(PALETTE_sampler2D, 2);
+
+	glUseProgram(0);
+}
+
+RiverbankProgram::~RiverbankProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GL.hpp"
+
+//Shader program that draws the riverbanks as one full-screen quad, from a texture holding each row's bank edges:
+// draw four vertices (no attributes) as a GL_TRIANGLE_STRIP; each pixel looks up the rows that can cover it.
+struct RiverbankProgram {
+	RiverbankProgram();
+	~RiverbankProgram();
+
+	GLuint program = 0;
+
+	//Uniform (per-invocation variable) locations:
+	GLuint FRAG_TO_RIVER_vec4 = -1U; //river pixel = gl_FragCoord.xy * FRAG_TO_RIVER.xy + FRAG_TO_RIVER.zw (camera included)
+	GLuint ROWS_int = -1U; //length of the BANKS ring
+	GLuint NEWEST_ROW_int = -1U; //rows (NEWEST_ROW - ROWS, NEWEST_ROW] are in BANKS
+	GLuint CLIFF_HEIGHT_int = -1U; //bank tops are drawn this far above their rows, over a cliff down to the row
+	GLuint CLIFF_TEXCOORD_vec2 = -1U; //TEX texel for cliffs
+	GLuint TOP_TEXCOORD_vec2 = -1U; //TEX texel for tops
+
+	//Textures:
+	//TEXTURE0 - TEX, tileset (palette indices)
+	//TEXTURE1 - BANKS, RG32F with the (left, right) bank x of row r at texel (r % ROWS, 0)
+	//TEXTURE2 - PALETTE, tileset color i at texel (i, 0)
+};
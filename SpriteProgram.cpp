@@ -0,0 +1,81 @@
+#include "SpriteProgram.hpp"
+
+#include "gl_compile_program.hpp"
+#include "gl_errors.hpp"
+
+SpriteProgram::SpriteProgram() {
+	program = gl_compile_program(
+		//vertex shader:
+		"#version 330\n"
+		"uniform mat4 OBJECT_TO_CLIP;\n"
+		"uniform vec4 CLIP_OFFSET;\n"
+		"uniform float TIME;\n"
+		"in vec2 Position;\n"
+		"in vec2 Size;\n"
+		"in vec4 TexRect;\n"
+		"in vec4 Color;\n"
+		"in vec2 Rotation;\n"
+		"in vec4 Cycle;\n"
+		"in vec4 Frames;\n"
+		"out vec4 color;\n"
+		"out vec2 texCoord;\n"
+		"void main() {\n"
+		//corners go around the rectangle in the same order as quads elsewhere: (0,0), (1,0), (1,1), (0,1):
+		"	int v = gl_VertexID & 3;\n"
+		"	vec2 corner = vec2((v == 1 || v == 2) ? 1.0 : 0.0, (v >= 2) ? 1.0 : 0.0);\n"
+		"	vec2 local = (corner - 0.5) * Size;\n"
+		"	vec2 position = Position + 0.5 * Size + vec2(Rotation.x * local.x + Rotation.y * local.y, -Rotation.y * local.x + Rotation.x * local.y);\n"
+		//(TIME * rate is only precise while TIME stays small, so callers wrap TIME; see TIME_float in SpriteProgram.hpp)
+		"	position.y += Cycle.w * sin(6.28318530718 * fract(Cycle.x + Cycle.y * TIME));\n"
+		"	gl_Position = OBJECT_TO_CLIP * vec4(position, 0.0, 1.0) + CLIP_OFFSET;\n"
+		"	color = Color;\n"
+		"	float frame = min(floor(Frames.x * fract(Cycle.x + Cycle.z * TIME)), Frames.x - 1.0);\n"
+		"	vec2 frame_offset = vec2(mod(frame, Frames.y), floor(frame / Frames.y)) * Frames.zw;\n"
+		"	texCoord = TexRect.xy + frame_offset + corner * TexRect.zw;\n"
+		"}\n"
+	,
+		//fragment shader:
+		"#version 330\n"
+		"uniform sampler2D TEX;\n"
+		"uniform bool INDEXED;\n"
+		"uniform sampler2D PALETTE;\n"
+		"in vec4 color;\n"
+		"in vec2 texCoord;\n"
+		"out vec4 fragColor;\n"
+		"void main() {\n"
+		"	vec4 texel = texture(TEX, texCoord);\n"
+		"	if (INDEXED) texel = texelFetch(PALETTE, ivec2(int(texel.r * 255.0 + 0.5), 0), 0);\n"
+		"	fragColor = texel * color;\n"
+		"}\n"
+	);
+
+	//look up the locations of vertex attributes:
+	Position_vec2 = glGetAttribLocation(program, "Position");
+	Size_vec2 = glGetAttribLocation(program, "Size");
+	TexRect_vec4 = glGetAttribLocation(program, "TexRect");
+	Color_vec4 = glGetAttribLocation(program, "Color");
+	Rotation_vec2 = glGetAttribLocation(program, "Rotation");
+	Cycle_vec4 = glGetAttribLocation(program, "Cycle");
+	Frames_vec4 = glGetAttribLocation(program, "Frames");
+
+	//look up the locations of uniforms:
+	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
+	CLIP_OFFSET_vec4 = glGetUniformLocation(program, "CLIP_OFFSET");
+	TIME_float = glGetUniformLocation(program, "TIME");
+	INDEXED_bool = glGetUniformLocation(program, "INDEXED");
+	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	GLuint PALETTE_sampler2D = glGetUniformLocation(program, "PALETTE");
+
+	//set TEX and PALETTE to always refer to texture bindings zero and two:
+	glUseProgram(program);
+
+	glUniform1i(TEX_sampler2D, 0);
+	glUniform1i(PALETTE_sampler2D, 2);
+
+	glUseProgram(0);
+}
+
+SpriteProgram::~SpriteProgram() {
+	glDeleteProgram(program);
+	program = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "GL.hpp"
+
+//Shader program that draws textured, tinted, (possibly) rotated rectangles from one record per rectangle:
+// draw with instancing (one instance per sprite, attributes advanced with glVertexAttribDivisor(..., 1)),
+// four vertices per instance (gl_VertexID 0-3 -- e.g., from quad_indices.hpp -- picks the corner).
+struct SpriteProgram {
+	SpriteProgram();
+	~SpriteProgram();
+
+	GLuint program = 0;
+
+	//Attribute (per-instance variable) locations:
+	GLuint Position_vec2 = -1U; //corner with the smallest coordinates (before rotation)
+	GLuint Size_vec2 = -1U;
+	GLuint TexRect_vec4 = -1U; //texture coordinates of that corner (xy) and the size of the texture rectangle (zw)
+	GLuint Color_vec4 = -1U;
+	GLuint Rotation_vec2 = -1U; //(cos, sin) of the rotation around the rectangle's center
+	//animation, so sprites can be left in a buffer while they move (Cycle (0, 0, 0, 0) and Frames (1, 1, 0, 0) for none):
+	// with bob cycle c = Phase + BobRate * TIME, the sprite is moved down by BobAmplitude * sin(2 pi c);
+	// with frame cycle f = Phase + FrameRate * TIME, frame floor(FrameCount * fract(f)) is shown,
+	// found by stepping TexRect.xy by FrameStep (Columns frames per row of frames):
+	GLuint Cycle_vec4 = -1U; //(Phase, BobRate, FrameRate, BobAmplitude)
+	GLuint Frames_vec4 = -1U; //(FrameCount, Columns, FrameStep.x, FrameStep.y)
+
+	//Uniform (per-invocation variable) locations:
+	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	GLuint CLIP_OFFSET_vec4 = -1U;
+	GLuint TIME_float = -1U; //seconds, wrapped by the caller at a period in which every rate completes a whole number of cycles
+	// (so BobRate * TIME and FrameRate * TIME stay small enough for float precision however long the game runs)
+	GLuint INDEXED_bool = -1U; //TEX holds palette indices (false by default)
+
+	//Textures:
+	//TEXTURE0 - texture that is accessed by TexRect
+	//TEXTURE2 - palette, with color i at texel (i, 0) (only read if INDEXED)
+};
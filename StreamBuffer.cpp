@@ -0,0 +1,74 @@
+#include "StreamBuffer.hpp"
+
+#include "gl_errors.hpp"
+
+#include <cstring>
+#include <cassert>
+
+StreamBuffer::StreamBuffer(size_t stride_, size_t region_elements_) : stride(stride_), region_elements(region_elements_) {
+	assert(region_elements > 0);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, Regions * region_elements * stride, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//start just before region 0, so the first upload uses it:
+	region = Regions - 1;
+
+	GL_ERRORS();
+}
+
+StreamBuffer::~StreamBuffer() {
+	for (GLsync &f : fences) {
+		if (f) glDeleteSync(f);
+		f = 0;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+size_t StreamBuffer::upload(void const *data, size_t count) {
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	if (count > region_elements) {
+		//rare: regions are too small, so re-specify the store (at double the needed size, so this doesn't repeat every frame);
+		// the driver keeps the old store alive for any draws still reading it, so no fences need to be waited on:
+		for (GLsync &f : fences) {
+			if (f) glDeleteSync(f);
+			f = 0;
+		}
+		region_elements = 2 * count;
+		glBufferData(GL_ARRAY_BUFFER, Regions * region_elements * stride, nullptr, GL_STREAM_DRAW);
+	}
+
+	region = (region + 1) % Regions;
+
+	//wait until the GPU is done with the draws that last read this region:
+	if (fences[region]) {
+		glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(-1));
+		glDeleteSync(fences[region]);
+		fences[region] = 0;
+	}
+
+	size_t first = region * region_elements;
+	if (count > 0) {
+		void *dst = glMapBufferRange(GL_ARRAY_BUFFER, first * stride, count * stride,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if (dst) {
+			std::memcpy(dst, data, count * stride);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+		} else {
+			//mapping can fail (e.g., out of memory); fall back to a plain upload:
+			glBufferSubData(GL_ARRAY_BUFFER, first * stride, count * stride, data);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return first;
+}
+
+void StreamBuffer::fence() {
+	if (fences[region]) glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstddef>
+
+/*
+ * StreamBuffer is a vertex buffer for data that is rewritten every frame.
+ * The buffer is split into Regions regions that are used round-robin:
+ *  each upload goes into the next region through an unsynchronized mapping,
+ *  and a fence placed after the draws that read it says when the region may be written again.
+ * So, in steady state, uploading neither reallocates the buffer store nor stalls on the GPU
+ *  (unless the CPU gets more than Regions frames ahead).
+ */
+
+struct StreamBuffer {
+	//'stride' is the size of one element; each region starts out holding 'region_elements':
+	StreamBuffer(size_t stride, size_t region_elements);
+	~StreamBuffer();
+
+	//copy 'count' elements from 'data' into the next region (growing the regions if needed);
+	// returns the index (in elements from the start of 'buffer') of the first element copied:
+	size_t upload(void const *data, size_t count);
+
+	//call after issuing the draws that read the most recent upload:
+	void fence();
+
+	static const size_t Regions = 3;
+
+	GLuint buffer = 0;
+	size_t stride;
+	size_t region_elements;
+	size_t region = 0; //region written by the most recent upload
+	GLsync fences[Regions] = { };
+
+	//(not copyable: owns GL objects)
+	StreamBuffer(StreamBuffer const &) = delete;
+	StreamBuffer &operator=(StreamBuffer const &) = delete;
+};
@@ -0,0 +1,25 @@
+//Generated by pack-atlas from boat-atlas.txt; re-run pack-atlas instead of editing this file.
+#pragma once
+
+#include "AtlasSprite.hpp"
+
+namespace boat_atlas {
+	//size of the atlas image:
+	constexpr uint32_t Width = 339;
+	constexpr uint32_t Height = 437;
+	//colors in the palette image:
+	constexpr uint32_t PaletteSize = 22;
+
+	//sprites, as { x, y, width, height, frames, columns }:
+	constexpr AtlasSprite boat_layers = { 1, 291, 24, 36, 36, 12 };
+	constexpr AtlasSprite boat_ripple = { 1, 1, 48, 72, 8, 4 };
+	constexpr AtlasSprite box = { 1, 400, 24, 36, 1, 1 };
+	constexpr AtlasSprite box_underwater = { 26, 400, 24, 36, 1, 1 };
+	constexpr AtlasSprite box_ripple = { 1, 146, 48, 72, 8, 4 };
+	constexpr AtlasSprite bomb = { 290, 291, 24, 36, 2, 2 };
+	constexpr AtlasSprite bomb_ripple = { 194, 1, 48, 72, 6, 3 };
+	constexpr AtlasSprite bank_cliff = { 261, 400, 1, 1, 1, 1 };
+	constexpr AtlasSprite bank_top = { 263, 400, 1, 1, 1, 1 };
+	constexpr AtlasSprite shade = { 265, 400, 1, 1, 1, 1 };
+	constexpr AtlasSprite font = { 51, 400, 11, 14, 38, 19 };
+}
@@ -0,0 +1,197 @@
+//boat-headless plays many games of BoatSim with a simple autopilot, as fast as possible.
+// no window, GL context, or audio device is created, so it runs fine on machines without a display.
+//
+//usage: boat-headless [games] [first-seed]
+//       boat-headless --play <replay file>
+//       boat-headless --check-retries [seed]
+
+#include "BoatSim.hpp"
+#include "Replay.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+
+//steer toward the middle of the river a little way ahead of the boat:
+static BoatSim::Input autopilot(BoatSim const &sim) {
+	const float LOOK_AHEAD = 64.0f;
+
+	glm::vec2 boat_center = sim.boat.position + 0.5f * sim.boat.size;
+	glm::vec2 target = glm::vec2(0.5f * BoatSim::RIVER_WIDTH, boat_center.y - LOOK_AHEAD);
+	float left, right;
+	if (sim.riverbank_x((int) target.y, &left, &right)) {
+		target.x = 0.5f * (left + right);
+	}
+
+	//boat moves along (-sin(rotation), -cos(rotation)):
+	glm::vec2 to_target = target - boat_center;
+	float desired = std::atan2(-to_target.x, -to_target.y);
+
+	BoatSim::Input input;
+	if (sim.boat.rotation < desired - 0.05f) input.left = true;
+	else if (sim.boat.rotation > desired + 0.05f) input.right = true;
+	input.up = true;
+	return input;
+}
+
+//re-simulate a recorded run (e.g. one saved by 'boat --record') without drawing it:
+static int play(std::string const &filename) {
+	Replay replay;
+	load_replay(filename, &replay);
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	BoatSim sim(replay.seed);
+	const float STEP = 1.0f / replay.tick_rate;
+	for (size_t tick = 0; tick < replay.inputs.size(); ++tick) {
+		sim.update(STEP, replay.input(tick));
+	}
+
+	auto after = std::chrono::high_resolution_clock::now();
+	float seconds = std::chrono::duration< float >(after - before).count();
+
+	std::cout << "Replayed " << replay.inputs.size() << " steps of '" << filename << "' in " << seconds << "s." << std::endl;
+	std::cout << "  final score: " << sim.score << "m" << (sim.game_over ? " (game over)" : "") << std::endl;
+	if (seconds > 0.0f) {
+		std::cout << "  " << replay.inputs.size() / seconds << " steps/second" << std::endl;
+	}
+	return 0;
+}
+
+//check that retrying after a game over gives a new course
+// (the seed, and so where the first obstacle is, changes on each reset):
+static int check_retries(uint32_t seed) {
+	BoatSim sim(seed);
+	//(obstacles are spawned in order of decreasing y, so the first of each kind is the lowest)
+	auto first_obstacle = [&sim]() {
+		glm::vec2 first = glm::vec2(0.0f, -1e30f);
+		if (!sim.boxes.empty() && sim.boxes.position(0).y > first.y) first = sim.boxes.position(0);
+		if (!sim.bombs.empty() && sim.bombs.position(0).y > first.y) first = sim.bombs.position(0);
+		return first;
+	};
+
+	BoatSim::Input retry;
+	retry.space = true;
+
+	uint32_t seeds[3];
+	glm::vec2 firsts[3];
+	for (uint32_t attempt = 0; attempt < 3; ++attempt) {
+		if (attempt > 0) {
+			sim.game_over = true;
+			sim.update(1.0f / 120.0f, retry);
+		}
+		seeds[attempt] = sim.seed;
+		firsts[attempt] = first_obstacle();
+		std::cout << "Attempt " << attempt << ": course seed " << seeds[attempt]
+			<< ", first obstacle at (" << firsts[attempt].x << ", " << firsts[attempt].y << ")." << std::endl;
+	}
+
+	bool ok = true;
+	for (uint32_t attempt = 1; attempt < 3; ++attempt) {
+		if (seeds[attempt] == seeds[attempt - 1] || firsts[attempt] == firsts[attempt - 1]) ok = false;
+	}
+	std::cout << (ok ? "Retries get new courses." : "FAILED: a retry repeated the previous course.") << std::endl;
+
+	//a game that ends before the camera moves (here, by holding down until the boat falls off the bottom)
+	// retries with the same newest river row, so whatever caches the river (e.g. BoatMode's riverbank mesh)
+	// has to notice the new course from the seed, not from the row index:
+	BoatSim early(seed);
+	BoatSim::Input down;
+	down.down = true;
+	for (uint32_t step = 0; step < 120 * 10 && !early.game_over; ++step) {
+		early.update(1.0f / 120.0f, down);
+	}
+	if (!early.game_over) {
+		std::cout << "FAILED: holding down didn't end the game." << std::endl;
+		return 1;
+	}
+	uint32_t early_seed = early.seed;
+	int32_t early_head = early.river_head.index;
+	const int PROBE_Y = -200; //(a row near the top of what's kept, so it's away from the shared starting rows)
+	glm::vec2 early_bank, retry_bank;
+	early.riverbank_x(PROBE_Y, &early_bank.x, &early_bank.y);
+	early.update(1.0f / 120.0f, retry);
+	early.riverbank_x(PROBE_Y, &retry_bank.x, &retry_bank.y);
+	std::cout << "Early game over: course seed " << early_seed << " -> " << early.seed
+		<< ", newest row " << early_head << " -> " << early.river_head.index
+		<< ", bank at y = " << PROBE_Y << " (" << early_bank.x << ", " << early_bank.y << ") -> (" << retry_bank.x << ", " << retry_bank.y << ")." << std::endl;
+	if (early.seed == early_seed || early_bank == retry_bank) {
+		std::cout << "FAILED: retrying after an early game over kept the course." << std::endl;
+		ok = false;
+	} else if (early.river_head.index == early_head) {
+		std::cout << "(newest row unchanged; only the seed tells the courses apart)" << std::endl;
+	}
+
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+	if (argc == 3 && std::string(argv[1]) == "--play") {
+		return play(argv[2]);
+	}
+	if ((argc == 2 || argc == 3) && std::string(argv[1]) == "--check-retries") {
+		return check_retries(argc == 3 ? (uint32_t) std::stoul(argv[2]) : 1);
+	}
+
+	//------------ parse arguments ------------
+	uint32_t games = 1000;
+	uint32_t first_seed = 1;
+	try {
+		if (argc > 1) games = (uint32_t) std::stoul(argv[1]);
+		if (argc > 2) first_seed = (uint32_t) std::stoul(argv[2]);
+	} catch (std::exception const &) {
+		std::cerr << "usage:\n\t" << argv[0] << " [games] [first-seed]\n\t" << argv[0] << " --play <replay file>\n\t" << argv[0] << " --check-retries [seed]" << std::endl;
+		return 1;
+	}
+
+	//games that the autopilot never loses are cut off after this many steps:
+	const uint32_t MAX_STEPS = 120 * 60 * 10;
+	const float STEP = 1.0f / 120.0f; //same fixed step as the game (Mode::Tick)
+
+	//------------ play ------------
+	uint64_t total_steps = 0;
+	float total_score = 0.0f;
+	float best_score = 0.0f;
+	uint32_t best_seed = first_seed;
+
+	auto before = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t game = 0; game < games; ++game) {
+		uint32_t seed = first_seed + game;
+		BoatSim sim(seed);
+
+		uint32_t steps = 0;
+		while (!sim.game_over && steps < MAX_STEPS) {
+			sim.update(STEP, autopilot(sim));
+			++steps;
+		}
+
+		total_steps += steps;
+		total_score += sim.score;
+		if (sim.score > best_score) {
+			best_score = sim.score;
+			best_seed = seed;
+		}
+	}
+
+	auto after = std::chrono::high_resolution_clock::now();
+	float seconds = std::chrono::duration< float >(after - before).count();
+
+	//------------ report ------------
+	std::cout << "Played " << games << " games (" << total_steps << " steps) in " << seconds << "s." << std::endl;
+	if (games > 0) {
+		std::cout << "  mean score: " << total_score / games << "m" << std::endl;
+		std::cout << "  best score: " << best_score << "m (seed " << best_seed << ")" << std::endl;
+	}
+	if (seconds > 0.0f) {
+		std::cout << "  " << games / seconds * 60.0f << " games/minute, " << total_steps / seconds << " steps/second" << std::endl;
+	}
+
+	return 0;
+}
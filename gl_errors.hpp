@@ -6,7 +6,7 @@
 #define STR2(X) # X
 #define STR(X) STR2(X)
 
-inline void gl_errors(std::string const &where) {
+inline void gl_errors(char const *where) { //(not std::string, so checking errors doesn't allocate)
 	GLenum err = 0;
 	while ((err = glGetError()) != GL_NO_ERROR) {
 		#define CHECK( ERR ) \
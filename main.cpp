@@ -6,6 +6,9 @@
 
 #include "BoatMode.hpp"
 
+//for recording / playing back runs:
+#include "Replay.hpp"
+
 //GL.hpp will include a non-namespace-polluting set of opengl prototypes:
 #include "GL.hpp"
 
@@ -21,6 +24,8 @@
 #include <stdexcept>
 #include <memory>
 #include <algorithm>
+#include <string>
+#include <ctime>
 
 int main(int argc, char **argv) {
 #ifdef _WIN32
@@ -28,6 +33,36 @@ int main(int argc, char **argv) {
 	try {
 #endif
 
+	//------------  command line ------------
+	//  --record <file> saves a replay of this session on exit
+	//  --play <file> plays a replay back, one tick per frame without vsync, then reports timing
+	//  --bank-shader draws the riverbanks with a per-pixel shader instead of the riverbank mesh
+	std::string record_filename;
+	std::string play_filename;
+	bool bank_shader = false;
+	for (int argi = 1; argi < argc; ++argi) {
+		std::string arg = argv[argi];
+		if (arg == "--record" && argi + 1 < argc) {
+			record_filename = argv[++argi];
+		} else if (arg == "--play" && argi + 1 < argc) {
+			play_filename = argv[++argi];
+		} else if (arg == "--bank-shader") {
+			bank_shader = true;
+		} else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--record <replay file>] [--play <replay file>] [--bank-shader]" << std::endl;
+			return 1;
+		}
+	}
+
+	Replay playback;
+	if (!play_filename.empty()) {
+		load_replay(play_filename, &playback);
+		if (playback.tick_rate != uint32_t(1.0f / Mode::Tick + 0.5f)) {
+			std::cerr << "Replay '" << play_filename << "' was recorded at " << playback.tick_rate << " ticks per second; can't play it back at " << uint32_t(1.0f / Mode::Tick + 0.5f) << "." << std::endl;
+			return 1;
+		}
+	}
+
 	//------------  initialization ------------
 
 	//Initialize SDL library:
@@ -77,11 +112,18 @@ int main(int argc, char **argv) {
 	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
 	init_GL();
 
-	//Set VSYNC + Late Swap (prevents crazy FPS):
-	if (SDL_GL_SetSwapInterval(-1) != 0) {
-		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
-		if (SDL_GL_SetSwapInterval(1) != 0) {
-			std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
+	if (!play_filename.empty()) {
+		//Replays run as fast as possible, so turn VSYNC off:
+		if (SDL_GL_SetSwapInterval(0) != 0) {
+			std::cerr << "NOTE: couldn't disable vsync (" << SDL_GetError() << ")." << std::endl;
+		}
+	} else {
+		//Set VSYNC + Late Swap (prevents crazy FPS):
+		if (SDL_GL_SetSwapInterval(-1) != 0) {
+			std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
+			if (SDL_GL_SetSwapInterval(1) != 0) {
+				std::cerr << "NOTE: couldn't set vsync (" << SDL_GetError() << ")." << std::endl;
+			}
 		}
 	}
 
@@ -91,7 +133,17 @@ int main(int argc, char **argv) {
 	//SDL_ShowCursor(SDL_DISABLE);
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< BoatMode >());
+	//(kept here as well so the recorded replay can be saved after the mode exits)
+	std::shared_ptr< BoatMode > boat_mode;
+	if (!play_filename.empty()) {
+		boat_mode = std::make_shared< BoatMode >(playback.seed);
+		boat_mode->playing_back = true;
+		boat_mode->playback = playback;
+	} else {
+		boat_mode = std::make_shared< BoatMode >((uint32_t)time(NULL));
+	}
+	boat_mode->draw_riverbanks_with_shader = bank_shader;
+	Mode::set_current(boat_mode);
 
 	//------------ main loop ------------
 
@@ -110,6 +162,10 @@ int main(int argc, char **argv) {
 	};
 	on_resize();
 
+	//for reporting replay playback speed:
+	auto loop_start_time = std::chrono::high_resolution_clock::now();
+	uint32_t frames = 0;
+
 	//This will loop until the current mode is set to null:
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
@@ -147,7 +203,7 @@ int main(int argc, char **argv) {
 			if (!Mode::current) break;
 		}
 
-		{ //(2) call the current mode's "update" function to deal with elapsed time:
+		{ //(2) call the current mode's "update" function once per fixed tick of elapsed time:
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -157,8 +213,20 @@ int main(int argc, char **argv) {
 			//lag to avoid spiral of death:
 			elapsed = std::min(0.1f, elapsed);
 
-			Mode::current->update(elapsed);
+			//replays advance exactly one tick per frame, however long the frame took:
+			if (!play_filename.empty()) elapsed = Mode::Tick;
+
+			//time not yet simulated carries over to the next frame:
+			static float accumulator = 0.0f;
+			accumulator += elapsed;
+			while (accumulator >= Mode::Tick) {
+				Mode::current->update(Mode::Tick);
+				if (!Mode::current) break;
+				accumulator -= Mode::Tick;
+			}
 			if (!Mode::current) break;
+
+			Mode::current->interpolate(accumulator / Mode::Tick);
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
@@ -168,7 +236,18 @@ int main(int argc, char **argv) {
 
 		//Wait until the recently-drawn frame is shown before doing it all again:
 		SDL_GL_SwapWindow(window);
+		++frames;
+	}
+
+	if (!play_filename.empty()) {
+		float seconds = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - loop_start_time).count();
+		std::cout << "Played " << boat_mode->playback_tick << " ticks of '" << play_filename << "' in " << frames << " frames, " << seconds << "s (" << frames / seconds << " fps); final score " << boat_mode->sim.score << "m." << std::endl;
+	}
+	if (!record_filename.empty()) {
+		save_replay(record_filename, boat_mode->recording);
+		std::cout << "Saved " << boat_mode->recording.inputs.size() << " ticks of input to '" << record_filename << "'." << std::endl;
 	}
+	boat_mode.reset(); //(free the mode's GL resources while the context still exists)
 
 
 	//------------  teardown ------------
@@ -0,0 +1,211 @@
+//pack-atlas copies the sprites listed in an atlas description (e.g., boat-atlas.txt) out of a source image
+// and packs them tightly into an atlas image, then writes a header of the packed rectangles (see AtlasSprite.hpp).
+//The atlas is palette-indexed: the index png holds each pixel's palette index (in every color channel),
+// and the palette png is one pixel per color (index 0 is transparent).
+//
+//usage: pack-atlas <description> <source png> <index png> <palette png> <header>
+//  e.g. (from this directory, after building with jam):
+//       dist/pack-atlas boat-atlas.txt dist/boat.png dist/boat-atlas-index.png dist/boat-atlas-palette.png boat_atlas.hpp
+//
+//It isn't run as part of the game build; re-run it (and commit the results) after changing boat.png or boat-atlas.txt.
+
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//transparent pixels left around each packed sprite, so nearest-neighbor lookups at sprite edges
+// (e.g., on rotated boat layers) can't pick up a neighbor:
+static const uint32_t Padding = 1;
+
+//palette indices are stored in one byte per texel:
+static const uint32_t MaxPaletteSize = 256;
+
+struct Entry {
+	std::string name;
+	uint32_t width = 0, height = 0;
+	uint32_t columns = 1;
+	std::vector< glm::uvec2 > frames; //upper-left corners in the source image
+	//packed block (all frames), including padding:
+	uint32_t block_width = 0, block_height = 0;
+	glm::uvec2 at = glm::uvec2(0); //upper-left corner of the block in the atlas
+};
+
+static std::vector< Entry > load_description(std::string const &filename) {
+	std::ifstream in(filename);
+	if (!in) throw std::runtime_error("Failed to open atlas description '" + filename + "'.");
+
+	std::vector< Entry > entries;
+	std::string line;
+	for (uint32_t line_number = 1; std::getline(in, line); ++line_number) {
+		auto fail = [&](std::string const &what) {
+			throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": " + what);
+		};
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream str(line);
+		Entry entry;
+		std::string colon;
+		if (!(str >> entry.name >> entry.width >> entry.height >> entry.columns >> colon) || colon != ":") {
+			fail("expected '<name> <width> <height> <columns> : <x>,<y> ...'");
+		}
+		if (entry.width == 0 || entry.height == 0 || entry.columns == 0) fail("sizes and column count must be positive");
+		for (auto const &e : entries) {
+			if (e.name == entry.name) fail("sprite '" + entry.name + "' is listed twice");
+		}
+
+		std::string corner;
+		while (str >> corner) {
+			glm::uvec2 at;
+			char comma = '\0';
+			std::istringstream corner_str(corner);
+			if (!(corner_str >> at.x >> comma >> at.y) || comma != ',') fail("bad frame corner '" + corner + "'");
+			entry.frames.emplace_back(at);
+		}
+		if (entry.frames.empty()) fail("sprite '" + entry.name + "' has no frames");
+
+		uint32_t frames = uint32_t(entry.frames.size());
+		uint32_t columns = std::min(entry.columns, frames);
+		uint32_t rows = (frames + columns - 1) / columns;
+		entry.block_width = columns * entry.width + Padding;
+		entry.block_height = rows * entry.height + Padding;
+		entries.emplace_back(entry);
+	}
+	return entries;
+}
+
+//place blocks on shelves (tallest first) in an atlas 'width' wide; returns the height used:
+static uint32_t pack_shelves(std::vector< Entry * > const &order, uint32_t width) {
+	uint32_t shelf_y = Padding, shelf_height = 0, x = Padding;
+	for (Entry *entry : order) {
+		if (x + entry->block_width > width) {
+			shelf_y += shelf_height;
+			shelf_height = 0;
+			x = Padding;
+		}
+		entry->at = glm::uvec2(x, shelf_y);
+		x += entry->block_width;
+		shelf_height = std::max(shelf_height, entry->block_height);
+	}
+	return shelf_y + shelf_height;
+}
+
+int main(int argc, char **argv) {
+	if (argc != 6) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <description> <source png> <index png> <palette png> <header>" << std::endl;
+		return 1;
+	}
+	std::string description_filename = argv[1];
+	std::string source_filename = argv[2];
+	std::string index_filename = argv[3];
+	std::string palette_filename = argv[4];
+	std::string header_filename = argv[5];
+
+	try {
+		std::vector< Entry > entries = load_description(description_filename);
+
+		glm::uvec2 source_size;
+		std::vector< glm::u8vec4 > source;
+		load_png(source_filename, &source_size, &source, UpperLeftOrigin);
+		for (auto const &entry : entries) {
+			for (auto const &at : entry.frames) {
+				if (at.x + entry.width > source_size.x || at.y + entry.height > source_size.y) {
+					throw std::runtime_error("A frame of '" + entry.name + "' runs off the edge of '" + source_filename + "'.");
+				}
+			}
+		}
+
+		//tallest blocks first (ties broken by name, so the layout only depends on the description):
+		std::vector< Entry * > order;
+		for (auto &entry : entries) order.emplace_back(&entry);
+		std::stable_sort(order.begin(), order.end(), [](Entry const *a, Entry const *b) {
+			if (a->block_height != b->block_height) return a->block_height > b->block_height;
+			return a->name < b->name;
+		});
+
+		//try every width from the widest block to all blocks side by side, and keep the smallest area:
+		uint32_t min_width = Padding, max_width = Padding;
+		for (auto const &entry : entries) {
+			min_width = std::max(min_width, entry.block_width + Padding);
+			max_width += entry.block_width;
+		}
+		glm::uvec2 size = glm::uvec2(0);
+		for (uint32_t width = min_width; width <= max_width; ++width) {
+			uint32_t height = pack_shelves(order, width);
+			if (size.x == 0 || uint64_t(width) * height < uint64_t(size.x) * size.y) size = glm::uvec2(width, height);
+		}
+		pack_shelves(order, size.x);
+
+		//copy frames into the atlas:
+		std::vector< glm::u8vec4 > atlas(size.x * size.y, glm::u8vec4(0, 0, 0, 0));
+		for (auto const &entry : entries) {
+			uint32_t columns = std::min(entry.columns, uint32_t(entry.frames.size()));
+			for (uint32_t f = 0; f < entry.frames.size(); ++f) {
+				glm::uvec2 from = entry.frames[f];
+				glm::uvec2 to = entry.at + glm::uvec2((f % columns) * entry.width, (f / columns) * entry.height);
+				for (uint32_t y = 0; y < entry.height; ++y) {
+					std::copy_n(&source[(from.y + y) * source_size.x + from.x], entry.width, &atlas[(to.y + y) * size.x + to.x]);
+				}
+			}
+		}
+
+		//convert to palette indices (all fully transparent pixels are the same color):
+		std::vector< glm::u8vec4 > palette;
+		palette.emplace_back(0, 0, 0, 0);
+		std::vector< glm::u8vec4 > indices;
+		indices.reserve(atlas.size());
+		for (glm::u8vec4 color : atlas) {
+			if (color.a == 0) color = glm::u8vec4(0, 0, 0, 0);
+			uint32_t index = uint32_t(std::find(palette.begin(), palette.end(), color) - palette.begin());
+			if (index == palette.size()) {
+				if (palette.size() == MaxPaletteSize) {
+					throw std::runtime_error("'" + source_filename + "' has more than " + std::to_string(MaxPaletteSize) + " colors in its sprites.");
+				}
+				palette.emplace_back(color);
+			}
+			indices.emplace_back(index, index, index, 255);
+		}
+		save_png(index_filename, size, indices.data(), UpperLeftOrigin);
+		save_png(palette_filename, glm::uvec2(palette.size(), 1), palette.data(), UpperLeftOrigin);
+
+		//header of packed rectangles:
+		std::ofstream header(header_filename);
+		header << "//Generated by pack-atlas from " << description_filename << "; re-run pack-atlas instead of editing this file.\n";
+		header << "#pragma once\n";
+		header << "\n";
+		header << "#include \"AtlasSprite.hpp\"\n";
+		header << "\n";
+		header << "namespace boat_atlas {\n";
+		header << "\t//size of the atlas image:\n";
+		header << "\tconstexpr uint32_t Width = " << size.x << ";\n";
+		header << "\tconstexpr uint32_t Height = " << size.y << ";\n";
+		header << "\t//colors in the palette image:\n";
+		header << "\tconstexpr uint32_t PaletteSize = " << palette.size() << ";\n";
+		header << "\n";
+		header << "\t//sprites, as { x, y, width, height, frames, columns }:\n";
+		for (auto const &entry : entries) {
+			header << "\tconstexpr AtlasSprite " << entry.name << " = { "
+				<< entry.at.x << ", " << entry.at.y << ", "
+				<< entry.width << ", " << entry.height << ", "
+				<< entry.frames.size() << ", " << std::min(entry.columns, uint32_t(entry.frames.size())) << " };\n";
+		}
+		header << "}\n";
+		if (!header) throw std::runtime_error("Failed to write '" + header_filename + "'.");
+
+		std::cout << "Packed " << entries.size() << " sprites into a " << size.x << "x" << size.y << " atlas"
+			<< " with " << palette.size() << " colors (" << source_size.x << "x" << source_size.y << " source)." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
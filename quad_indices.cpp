@@ -0,0 +1,45 @@
+#include "quad_indices.hpp"
+
+#include "gl_errors.hpp"
+
+#include <vector>
+#include <cstdint>
+
+//16-bit indices cover this many quads; longer runs are drawn in several calls:
+static const size_t MaxQuads = 65536 / 4;
+
+GLuint quad_index_buffer() {
+	static GLuint buffer = 0;
+	if (buffer == 0) {
+		std::vector< uint16_t > indices;
+		indices.reserve(MaxQuads * 6);
+		for (uint32_t q = 0; q < MaxQuads; ++q) {
+			uint16_t v = uint16_t(q * 4);
+			indices.emplace_back(v + 0);
+			indices.emplace_back(v + 1);
+			indices.emplace_back(v + 2);
+			indices.emplace_back(v + 0);
+			indices.emplace_back(v + 2);
+			indices.emplace_back(v + 3);
+		}
+
+		glGenBuffers(1, &buffer);
+		//(bound to GL_ARRAY_BUFFER for upload so this doesn't disturb whatever vertex array object is bound)
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(indices[0]), indices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		GL_ERRORS();
+	}
+	return buffer;
+}
+
+void draw_quads(GLint first_vertex, size_t quads) {
+	while (quads > 0) {
+		size_t batch = (quads < MaxQuads ? quads : MaxQuads);
+		//(base vertex offsets the indices, so the same 0-based indices work anywhere in the vertex buffer)
+		glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(batch * 6), GL_UNSIGNED_SHORT, (GLbyte *)0, first_vertex);
+		first_vertex += GLint(batch * 4);
+		quads -= batch;
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <cstddef>
+
+/*
+ * Quads are drawn as 4 vertices each, given in order around the quad,
+ *  plus a static index buffer (shared by every mode) that splits each quad into two triangles: 0,1,2 and 0,2,3.
+ *
+ * To use it, bind it into a vertex array object while setting that up:
+ *   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_index_buffer());
+ * and then draw with draw_quads() while the vertex array object is bound.
+ */
+
+//the shared index buffer (created on first use -- a GL context must be current -- and freed along with the context):
+GLuint quad_index_buffer();
+
+//draw 'quads' quads (as GL_TRIANGLES) from the bound vertex array, starting at vertex 'first_vertex':
+void draw_quads(GLint first_vertex, size_t quads);